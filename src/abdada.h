@@ -0,0 +1,79 @@
+/*
+  Clover is a UCI chess playing engine authored by Luca Metehau.
+  <https://github.com/lucametehau/CloverEngine>
+
+  Clover is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Clover is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "defs.h"
+#include <array>
+#include <atomic>
+
+// minimum depth at which moves are marked and deferred, shallower nodes aren't worth the contention
+constexpr int ABDADA_DEFER_DEPTH = 3;
+// at most this many moves are deferred in a node, the others are searched right away
+constexpr int ABDADA_MAX_DEFERRED = 32;
+
+// a deferred move, with the number of moves searched before it when it was first picked
+struct DeferredMove
+{
+    Move move;
+    int index;
+};
+
+// Simplified ABDADA: a small table holding the keys of positions currently searched by some thread.
+// A thread can postpone a move whose resulting position is already being searched, searching it
+// after the rest of the moves, when the other thread has (hopefully) filled the TT entry.
+class AbdadaTable
+{
+  private:
+    static constexpr int SIZE_LOG = 15;
+    static constexpr uint64_t SIZE = 1ULL << SIZE_LOG;
+    std::array<std::atomic<Key>, SIZE> table;
+
+    std::atomic<Key> &slot(const Key key)
+    {
+        return table[key >> (64 - SIZE_LOG)];
+    }
+
+  public:
+    AbdadaTable()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (auto &entry : table)
+            entry.store(0, std::memory_order_relaxed);
+    }
+
+    bool is_searching(const Key key)
+    {
+        return slot(key).load(std::memory_order_relaxed) == key;
+    }
+
+    void start_search(const Key key)
+    {
+        slot(key).store(key, std::memory_order_relaxed);
+    }
+
+    // only clear the slot if no other position replaced it in the meantime
+    void finish_search(const Key key)
+    {
+        Key expected = key;
+        slot(key).compare_exchange_strong(expected, 0, std::memory_order_relaxed);
+    }
+};
+
+static AbdadaTable abdada_table;
@@ -22,15 +22,47 @@
 namespace attacks
 {
 
-inline std::array<Bitboard, 64> rookAttacksMask, bishopAttacksMask;
-inline MultiArray<Bitboard, 2, 64> pawnAttacksMask;
-inline MultiArray<Bitboard, 64, 4096> rookTable;
-inline MultiArray<Bitboard, 64, 512> bishopTable;
-inline MultiArray<Bitboard, 64, 8> raysMask;
-inline std::array<Bitboard, 64> knightBBAttacks, kingBBAttacks;
-inline std::array<Bitboard, 64> kingRingMask, kingSquareMask, pawnShieldMask;
+// everything but the slider attack tables is computed at compile time
 
-inline Bitboard genAttacksBishopSlow(Bitboard blockers, Square sq)
+inline constexpr MultiArray<Bitboard, 64, 8> raysMask = [] {
+    MultiArray<Bitboard, 64, 8> raysMask{};
+    for (int rank = 0; rank < 8; rank++)
+    {
+        for (int file = 0; file < 8; file++)
+        {
+            int r, f;
+            Square sq = Square(rank, file);
+            r = rank, f = file;
+            while (r > 0)
+                r--, raysMask[sq][SOUTH_ID] |= Bitboard(Square(r, f));
+            r = rank, f = file;
+            while (r < 7)
+                r++, raysMask[sq][NORTH_ID] |= Bitboard(Square(r, f));
+            r = rank, f = file;
+            while (f > 0)
+                f--, raysMask[sq][WEST_ID] |= Bitboard(Square(r, f));
+            r = rank, f = file;
+            while (f < 7)
+                f++, raysMask[sq][EAST_ID] |= Bitboard(Square(r, f));
+
+            r = rank, f = file;
+            while (r > 0 && f > 0)
+                r--, f--, raysMask[sq][SOUTHWEST_ID] |= Bitboard(Square(r, f));
+            r = rank, f = file;
+            while (r < 7 && f > 0)
+                r++, f--, raysMask[sq][NORTHWEST_ID] |= Bitboard(Square(r, f));
+            r = rank, f = file;
+            while (r > 0 && f < 7)
+                r--, f++, raysMask[sq][SOUTHEAST_ID] |= Bitboard(Square(r, f));
+            r = rank, f = file;
+            while (r < 7 && f < 7)
+                r++, f++, raysMask[sq][NORTHEAST_ID] |= Bitboard(Square(r, f));
+        }
+    }
+    return raysMask;
+}();
+
+constexpr Bitboard genAttacksBishopSlow(Bitboard blockers, Square sq)
 {
     Bitboard attacks(0ull);
 
@@ -61,7 +93,7 @@ inline Bitboard genAttacksBishopSlow(Bitboard blockers, Square sq)
     return attacks;
 }
 
-inline Bitboard genAttacksRookSlow(Bitboard blockers, Square sq)
+constexpr Bitboard genAttacksRookSlow(Bitboard blockers, Square sq)
 {
     Bitboard attacks(0ull);
 
@@ -92,22 +124,31 @@ inline Bitboard genAttacksRookSlow(Bitboard blockers, Square sq)
     return attacks;
 }
 
-inline Bitboard get_blockers(Bitboard mask, int ind)
-{
-    int nr = mask.count();
-    Bitboard blockers(0ull);
-    for (Square i = 0; i < nr; i++)
+inline constexpr MultiArray<Bitboard, 2, 64> pawnAttacksMask = [] {
+    MultiArray<Bitboard, 2, 64> pawnAttacksMask{};
+    for (Square i = 0; i < 64; i++)
     {
-        Bitboard lsb = mask.lsb();
-        if (ind & Bitboard(i))
-            blockers |= lsb;
-        mask ^= lsb;
+        int file = i % 8;
+        if (file > 0)
+        {
+            if (i + 7 < 64)
+                pawnAttacksMask[WHITE][i] |= (1ULL << (i + 7));
+            if (i >= 9)
+                pawnAttacksMask[BLACK][i] |= (1ULL << (i - 9));
+        }
+        if (file < 7)
+        {
+            if (i + 9 < 64)
+                pawnAttacksMask[WHITE][i] |= (1ULL << (i + 9));
+            if (i >= 7)
+                pawnAttacksMask[BLACK][i] |= (1ULL << (i - 7));
+        }
     }
-    return blockers;
-}
+    return pawnAttacksMask;
+}();
 
-inline void initKnightAndKingAttacks()
-{
+inline constexpr std::array<std::array<Bitboard, 64>, 2> knight_and_king_attacks = [] {
+    std::array<Bitboard, 64> knightBBAttacks{}, kingBBAttacks{};
     for (Square i = 0; i < 64; i++)
     {
         int rank = i / 8, file = i % 8;
@@ -124,9 +165,14 @@ inline void initKnightAndKingAttacks()
                 kingBBAttacks[i] |= Bitboard(Square(rankTo, fileTo));
         }
     }
+    return std::array{knightBBAttacks, kingBBAttacks};
+}();
+inline constexpr const std::array<Bitboard, 64> &knightBBAttacks = knight_and_king_attacks[0];
+inline constexpr const std::array<Bitboard, 64> &kingBBAttacks = knight_and_king_attacks[1];
 
-    /// king area masks
-
+/// king area masks
+inline constexpr std::array<std::array<Bitboard, 64>, 3> king_area_masks = [] {
+    std::array<Bitboard, 64> kingRingMask{}, kingSquareMask{}, pawnShieldMask{};
     for (Square i = 0; i < 64; i++)
     {
         int rank = i / 8, file = i % 8;
@@ -152,113 +198,82 @@ inline void initKnightAndKingAttacks()
         else if (rank >= 6)
             pawnShieldMask[i] = shift_mask<SOUTH>(WHITE, kingSquareMask[i]);
     }
-}
+    return std::array{kingRingMask, kingSquareMask, pawnShieldMask};
+}();
+inline constexpr const std::array<Bitboard, 64> &kingRingMask = king_area_masks[0];
+inline constexpr const std::array<Bitboard, 64> &kingSquareMask = king_area_masks[1];
+inline constexpr const std::array<Bitboard, 64> &pawnShieldMask = king_area_masks[2];
 
-inline void initPawnAttacks()
-{
-    for (Square i = 0; i < 64; i++)
+inline constexpr std::array<Bitboard, 64> rookAttacksMask = [] {
+    std::array<Bitboard, 64> rookAttacksMask{};
+    for (Square sq = 0; sq < 64; sq++)
     {
-        int file = i % 8;
-        if (file > 0)
-        {
-            if (i + 7 < 64)
-                pawnAttacksMask[WHITE][i] |= (1ULL << (i + 7));
-            if (i >= 9)
-                pawnAttacksMask[BLACK][i] |= (1ULL << (i - 9));
-        }
-        if (file < 7)
-        {
-            if (i + 9 < 64)
-                pawnAttacksMask[WHITE][i] |= (1ULL << (i + 9));
-            if (i >= 7)
-                pawnAttacksMask[BLACK][i] |= (1ULL << (i - 7));
-        }
+        rookAttacksMask[sq] |= raysMask[sq][NORTH_ID] & ~rank_mask[7];
+        rookAttacksMask[sq] |= raysMask[sq][SOUTH_ID] & ~rank_mask[0];
+        rookAttacksMask[sq] |= raysMask[sq][EAST_ID] & not_edge_mask[1];
+        rookAttacksMask[sq] |= raysMask[sq][WEST_ID] & not_edge_mask[0];
     }
-}
+    return rookAttacksMask;
+}();
 
-inline void initRays()
-{
-    for (int rank = 0; rank < 8; rank++)
+inline constexpr std::array<Bitboard, 64> bishopAttacksMask = [] {
+    std::array<Bitboard, 64> bishopAttacksMask{};
+    Bitboard edge = (file_mask[0] | file_mask[7] | rank_mask[0] | rank_mask[7]);
+    for (Square sq = 0; sq < 64; sq++)
     {
-        for (int file = 0; file < 8; file++)
-        {
-            int r, f;
-            Square sq = Square(rank, file);
-            r = rank, f = file;
-            while (r > 0)
-                r--, raysMask[sq][SOUTH_ID] |= Bitboard(Square(r, f));
-            r = rank, f = file;
-            while (r < 7)
-                r++, raysMask[sq][NORTH_ID] |= Bitboard(Square(r, f));
-            r = rank, f = file;
-            while (f > 0)
-                f--, raysMask[sq][WEST_ID] |= Bitboard(Square(r, f));
-            r = rank, f = file;
-            while (f < 7)
-                f++, raysMask[sq][EAST_ID] |= Bitboard(Square(r, f));
-
-            r = rank, f = file;
-            while (r > 0 && f > 0)
-                r--, f--, raysMask[sq][SOUTHWEST_ID] |= Bitboard(Square(r, f));
-            r = rank, f = file;
-            while (r < 7 && f > 0)
-                r++, f--, raysMask[sq][NORTHWEST_ID] |= Bitboard(Square(r, f));
-            r = rank, f = file;
-            while (r > 0 && f < 7)
-                r--, f++, raysMask[sq][SOUTHEAST_ID] |= Bitboard(Square(r, f));
-            r = rank, f = file;
-            while (r < 7 && f < 7)
-                r++, f++, raysMask[sq][NORTHEAST_ID] |= Bitboard(Square(r, f));
-        }
+        bishopAttacksMask[sq] = (raysMask[sq][NORTHWEST_ID] | raysMask[sq][SOUTHWEST_ID] | raysMask[sq][NORTHEAST_ID] |
+                                 raysMask[sq][SOUTHEAST_ID]) &
+                                (~edge);
     }
-}
+    return bishopAttacksMask;
+}();
+
+// the slider tables are too large to build in a constant expression in reasonable time
+inline std::array<Bitboard, ROOK_TABLE_SIZE> rookTable;
+inline std::array<Bitboard, BISHOP_TABLE_SIZE> bishopTable;
 
 inline void initRookMagic()
 {
     for (Square sq = 0; sq < 64; sq++)
     {
-        rookAttacksMask[sq] |= raysMask[sq][NORTH_ID] & ~rank_mask[7];
-        rookAttacksMask[sq] |= raysMask[sq][SOUTH_ID] & ~rank_mask[0];
-        rookAttacksMask[sq] |= raysMask[sq][EAST_ID] & not_edge_mask[1];
-        rookAttacksMask[sq] |= raysMask[sq][WEST_ID] & not_edge_mask[0];
-        for (int blockerInd = 0; blockerInd < (1 << rookIndexBits[sq]); blockerInd++)
+        // walk all the subsets of the mask
+        Bitboard blockers(0ull);
+        do
         {
-            Bitboard blockers = get_blockers(rookAttacksMask[sq], blockerInd);
 #ifndef PEXT_GOOD
-            rookTable[sq][(blockers * rookMagics[sq]) >> (64 - rookIndexBits[sq])] = genAttacksRookSlow(blockers, sq);
+            rookTable[rookTableOffset[sq] + ((blockers * rookMagics[sq]) >> (64 - rookIndexBits[sq]))] =
+                genAttacksRookSlow(blockers, sq);
 #else
-            rookTable[sq][_pext_u64(blockers, rookAttacksMask[sq])] = genAttacksRookSlow(blockers, sq);
+            rookTable[rookTableOffset[sq] + _pext_u64(blockers, rookAttacksMask[sq])] =
+                genAttacksRookSlow(blockers, sq);
 #endif
-        }
+            blockers = (blockers - rookAttacksMask[sq]) & rookAttacksMask[sq];
+        } while (blockers);
     }
 }
 
 inline void initBishopMagic()
 {
-    Bitboard edge = (file_mask[0] | file_mask[7] | rank_mask[0] | rank_mask[7]);
     for (Square sq = 0; sq < 64; sq++)
     {
-        bishopAttacksMask[sq] = (raysMask[sq][NORTHWEST_ID] | raysMask[sq][SOUTHWEST_ID] | raysMask[sq][NORTHEAST_ID] |
-                                 raysMask[sq][SOUTHEAST_ID]) &
-                                (~edge);
-        for (int blockerInd = 0; blockerInd < (1 << bishopIndexBits[sq]); blockerInd++)
+        // walk all the subsets of the mask
+        Bitboard blockers(0ull);
+        do
         {
-            Bitboard blockers = get_blockers(bishopAttacksMask[sq], blockerInd);
 #ifndef PEXT_GOOD
-            bishopTable[sq][(blockers * bishopMagics[sq]) >> (64 - bishopIndexBits[sq])] =
+            bishopTable[bishopTableOffset[sq] + ((blockers * bishopMagics[sq]) >> (64 - bishopIndexBits[sq]))] =
                 genAttacksBishopSlow(blockers, sq);
 #else
-            bishopTable[sq][_pext_u64(blockers, bishopAttacksMask[sq])] = genAttacksBishopSlow(blockers, sq);
+            bishopTable[bishopTableOffset[sq] + _pext_u64(blockers, bishopAttacksMask[sq])] =
+                genAttacksBishopSlow(blockers, sq);
 #endif
-        }
+            blockers = (blockers - bishopAttacksMask[sq]) & bishopAttacksMask[sq];
+        } while (blockers);
     }
 }
 
 inline void init()
 {
-    initRays();
-    initPawnAttacks();
-    initKnightAndKingAttacks();
     initBishopMagic();
     initRookMagic();
 }
@@ -276,18 +291,20 @@ static constexpr Bitboard genAttacksKnight(Square sq)
 static inline Bitboard genAttacksBishop(Bitboard blockers, Square sq)
 {
 #ifndef PEXT_GOOD
-    return bishopTable[sq][((blockers & bishopAttacksMask[sq]) * bishopMagics[sq]) >> (64 - bishopIndexBits[sq])];
+    return bishopTable[bishopTableOffset[sq] +
+                       (((blockers & bishopAttacksMask[sq]) * bishopMagics[sq]) >> (64 - bishopIndexBits[sq]))];
 #else
-    return bishopTable[sq][_pext_u64(blockers, bishopAttacksMask[sq])];
+    return bishopTable[bishopTableOffset[sq] + _pext_u64(blockers, bishopAttacksMask[sq])];
 #endif
 }
 
 static inline Bitboard genAttacksRook(Bitboard blockers, Square sq)
 {
 #ifndef PEXT_GOOD
-    return rookTable[sq][((blockers & rookAttacksMask[sq]) * rookMagics[sq]) >> (64 - rookIndexBits[sq])];
+    return rookTable[rookTableOffset[sq] +
+                     (((blockers & rookAttacksMask[sq]) * rookMagics[sq]) >> (64 - rookIndexBits[sq]))];
 #else
-    return rookTable[sq][_pext_u64(blockers, rookAttacksMask[sq])];
+    return rookTable[rookTableOffset[sq] + _pext_u64(blockers, rookAttacksMask[sq])];
 #endif
 }
 
@@ -40,7 +40,7 @@ class Bitboard
         return bb;
     }
 
-    Square get_square_pop()
+    constexpr Square get_square_pop()
     {
         const Square sq = get_lsb_square();
         bb &= bb - 1;
@@ -89,32 +89,32 @@ class Bitboard
         return ~bb;
     }
 
-    Bitboard &operator|=(const Bitboard &other)
+    constexpr Bitboard &operator|=(const Bitboard &other)
     {
         bb |= other.bb;
         return *this;
     }
-    Bitboard &operator&=(const Bitboard &other)
+    constexpr Bitboard &operator&=(const Bitboard &other)
     {
         bb &= other.bb;
         return *this;
     }
-    Bitboard &operator^=(const Bitboard &other)
+    constexpr Bitboard &operator^=(const Bitboard &other)
     {
         bb ^= other.bb;
         return *this;
     }
-    Bitboard &operator|=(const unsigned long long &other)
+    constexpr Bitboard &operator|=(const unsigned long long &other)
     {
         bb |= other;
         return *this;
     }
-    Bitboard &operator&=(const unsigned long long &other)
+    constexpr Bitboard &operator&=(const unsigned long long &other)
     {
         bb &= other;
         return *this;
     }
-    Bitboard &operator^=(const unsigned long long &other)
+    constexpr Bitboard &operator^=(const unsigned long long &other)
     {
         bb ^= other;
         return *this;
@@ -135,15 +135,15 @@ class Bitboard
         return bb == other.bb;
     }
 
-    void set_bit(Square sq)
+    constexpr void set_bit(Square sq)
     {
         bb |= (1ull << sq);
     }
-    void erase_bit(Square sq)
+    constexpr void erase_bit(Square sq)
     {
         bb &= ~(1ull << sq);
     }
-    void toggle_bit(Square sq)
+    constexpr void toggle_bit(Square sq)
     {
         bb ^= (1ull << sq);
     }
@@ -32,14 +32,23 @@ struct HistoricalState
     MultiArray<Square, 2, 2> rook_sq;
     Piece captured;
     uint16_t halfMoves, moveIndex;
-    Bitboard checkers, pinnedPieces;
     Key key, pawn_key, mat_key[2];
-    Threats threats;
 
     HistoricalState *prev;
     HistoricalState *next;
+
+    // computed on demand, many nodes return before needing them
+    bool checkers_ready, threats_ready;
+    Bitboard checkers, pinnedPieces;
+    Threats threats;
 };
 
+// making a move only copies the state up to the links and the lazily computed part
+constexpr std::size_t HISTORICAL_STATE_COPY_SIZE = offsetof(HistoricalState, prev);
+
+// keys of the last positions, indexed by game ply, so repetition checks scan an array instead of the state list
+constexpr int KEY_HISTORY_SIZE = 256;
+
 class Board
 {
   public:
@@ -51,6 +60,8 @@ class Board
 
     uint16_t ply, game_ply;
 
+    std::array<Key, KEY_HISTORY_SIZE> key_history;
+
     std::array<Bitboard, 12> bb;
     std::array<Bitboard, 2> pieces;
 
@@ -100,20 +111,16 @@ class Board
     {
         return state->mat_key[color];
     }
-    Bitboard &checkers()
-    {
-        return state->checkers;
-    }
-    constexpr Bitboard checkers() const
+    Bitboard checkers() const
     {
+        if (!state->checkers_ready)
+            get_pinned_pieces_and_checkers();
         return state->checkers;
     }
-    Bitboard &pinned_pieces()
-    {
-        return state->pinnedPieces;
-    }
-    constexpr Bitboard pinned_pieces() const
+    Bitboard pinned_pieces() const
     {
+        if (!state->checkers_ready)
+            get_pinned_pieces_and_checkers();
         return state->pinnedPieces;
     }
     Square &enpas()
@@ -148,13 +155,30 @@ class Board
     {
         return state->captured;
     }
-    Threats &threats()
+    const Threats &threats() const
     {
+        if (!state->threats_ready)
+            get_threats(turn);
         return state->threats;
     }
-    constexpr Threats threats() const
+    // called once the position of a new state is set up
+    void reset_lazy_state()
     {
-        return state->threats;
+        state->checkers_ready = state->threats_ready = false;
+    }
+    void push_key()
+    {
+        key_history[game_ply & (KEY_HISTORY_SIZE - 1)] = key();
+    }
+    // key of the position from i plies ago
+    constexpr Key key_ago(const int i) const
+    {
+        return key_history[(game_ply - i) & (KEY_HISTORY_SIZE - 1)];
+    }
+    // how far back repetitions can be, the ring only remembers the last KEY_HISTORY_SIZE positions
+    constexpr int repetition_window() const
+    {
+        return std::min(std::min<int>(game_ply, half_moves()), KEY_HISTORY_SIZE - 1);
     }
     Square &rook_sq(bool color, bool side)
     {
@@ -164,6 +188,11 @@ class Board
     {
         return state->rook_sq[color][side];
     }
+    constexpr bool has_castling_rights() const
+    {
+        return rook_sq(WHITE, 0) != NO_SQUARE || rook_sq(WHITE, 1) != NO_SQUARE || rook_sq(BLACK, 0) != NO_SQUARE ||
+               rook_sq(BLACK, 1) != NO_SQUARE;
+    }
 
     constexpr Bitboard get_bb_color(const bool color) const
     {
@@ -202,12 +231,13 @@ class Board
         return (count - 2) / 4;
     }
 
-    void get_pinned_pieces_and_checkers()
+    void get_pinned_pieces_and_checkers() const
     {
         const bool enemy = turn ^ 1;
         const Square king = get_king(turn);
         Bitboard us = pieces[turn], them = pieces[enemy];
-        pinned_pieces() = checkers() = Bitboard(0ull);
+        Bitboard &checkers = state->checkers, &pinned_pieces = state->pinnedPieces;
+        pinned_pieces = checkers = Bitboard(0ull);
         Bitboard mask = (attacks::genAttacksRook(them, king) & orthogonal_sliders(enemy)) |
                         (attacks::genAttacksBishop(them, king) & diagonal_sliders(enemy));
 
@@ -216,17 +246,19 @@ class Board
             Square sq = mask.get_square_pop();
             Bitboard b2 = us & between_mask[sq][king];
             if (b2.count() == 1)
-                pinned_pieces() |= b2;
+                pinned_pieces |= b2;
             else if (!b2)
-                checkers() |= (1ull << sq);
+                checkers |= (1ull << sq);
         }
 
-        checkers() |= (attacks::genAttacksKnight(king) & get_bb_piece(PieceTypes::KNIGHT, enemy)) |
-                      (attacks::genAttacksPawn(turn, king) & get_bb_piece(PieceTypes::PAWN, enemy));
+        checkers |= (attacks::genAttacksKnight(king) & get_bb_piece(PieceTypes::KNIGHT, enemy)) |
+                    (attacks::genAttacksPawn(turn, king) & get_bb_piece(PieceTypes::PAWN, enemy));
+        state->checkers_ready = true;
     }
 
-    void get_threats(const bool color)
+    void get_threats(const bool color) const
     {
+        Threats &threats = state->threats;
         const bool enemy = 1 ^ color;
         Bitboard our_pieces = get_bb_color(color) ^ get_bb_piece(PieceTypes::PAWN, color);
         Bitboard att = get_pawn_attacks(enemy);
@@ -234,10 +266,10 @@ class Board
         Bitboard pieces, att_mask;
         Bitboard all = get_bb_color(WHITE) | get_bb_color(BLACK);
 
-        threats().threats_pieces[PieceTypes::PAWN] = att;
-        threats().threats_pieces[PieceTypes::KNIGHT] = 0;
-        threats().threats_pieces[PieceTypes::BISHOP] = 0;
-        threats().threats_pieces[PieceTypes::ROOK] = 0;
+        threats.threats_pieces[PieceTypes::PAWN] = att;
+        threats.threats_pieces[PieceTypes::KNIGHT] = 0;
+        threats.threats_pieces[PieceTypes::BISHOP] = 0;
+        threats.threats_pieces[PieceTypes::ROOK] = 0;
         our_pieces ^= get_bb_piece(PieceTypes::KNIGHT, color) | get_bb_piece(PieceTypes::BISHOP, color);
 
         pieces = get_bb_piece(PieceTypes::KNIGHT, enemy);
@@ -245,7 +277,7 @@ class Board
         {
             att_mask = attacks::genAttacksKnight(pieces.get_square_pop());
             att |= att_mask;
-            threats().threats_pieces[PieceTypes::KNIGHT] |= att_mask;
+            threats.threats_pieces[PieceTypes::KNIGHT] |= att_mask;
         }
         threatened_pieces |= att & our_pieces;
 
@@ -256,7 +288,7 @@ class Board
         {
             att_mask = attacks::genAttacksBishop(all, pieces.get_square_pop());
             att |= att_mask;
-            threats().threats_pieces[PieceTypes::BISHOP] |= att_mask;
+            threats.threats_pieces[PieceTypes::BISHOP] |= att_mask;
         }
         threatened_pieces |= att & our_pieces;
 
@@ -267,7 +299,7 @@ class Board
         {
             att_mask = attacks::genAttacksRook(all, pieces.get_square_pop());
             att |= att_mask;
-            threats().threats_pieces[PieceTypes::ROOK] |= att_mask;
+            threats.threats_pieces[PieceTypes::ROOK] |= att_mask;
         }
         threatened_pieces |= att & our_pieces;
 
@@ -276,8 +308,9 @@ class Board
             att |= attacks::genAttacksQueen(all, pieces.get_square_pop());
 
         att |= attacks::genAttacksKing(get_king(enemy));
-        threats().all_threats = att;
-        threats().threatened_pieces = threatened_pieces;
+        threats.all_threats = att;
+        threats.threatened_pieces = threatened_pieces;
+        state->threats_ready = true;
     }
 
     constexpr Bitboard get_pawn_attacks(const bool color) const
@@ -321,7 +354,17 @@ class Board
 
     template <int movegen_type> constexpr int gen_legal_moves(MoveList &moves) const;
 
-    constexpr bool is_pseudo_legal(Move move) const
+    constexpr bool is_legal(Move move) const
+    {
+        return turn == WHITE ? is_legal<WHITE>(move) : is_legal<BLACK>(move);
+    }
+
+  private:
+    // the side to move is a template parameter, making pawn directions, ranks and castling squares constants
+    template <bool color> void make_move(const Move move, HistoricalState &state);
+    template <int movegen_type, bool color> constexpr int gen_legal_moves(MoveList &moves) const;
+
+    template <bool color> constexpr bool is_pseudo_legal(Move move) const
     {
         if (!move)
             return false;
@@ -329,7 +372,6 @@ class Board
         const Square from = move.get_from(), to = move.get_to();
         const int t = move.get_type();
         const Piece pt = piece_type_at(from);
-        const bool color = turn;
         const Bitboard own = get_bb_color(color), enemy = get_bb_color(1 ^ color);
         const Bitboard occ = own | enemy;
 
@@ -366,12 +408,12 @@ class Board
         return t == MoveTypes::NO_TYPE && attacks::genAttacksSq(occ, from, pt).has_square(to);
     }
 
-    constexpr bool is_legal(Move move) const
+    template <bool us> constexpr bool is_legal(Move move) const
     {
-        if (!is_pseudo_legal(move))
+        if (!is_pseudo_legal<us>(move))
             return false;
 
-        const bool us = turn, enemy = 1 ^ us;
+        constexpr bool enemy = 1 ^ us;
         const Square king = get_king(us);
         Square from = move.get_from(), to = move.get_to();
         const Bitboard all = get_bb_color(WHITE) | get_bb_color(BLACK);
@@ -421,6 +463,7 @@ class Board
                                        : (checkers() | between_mask[king][checkers().get_lsb_square()]).has_square(to);
     }
 
+  public:
     constexpr bool has_non_pawn_material(const bool color) const
     {
         return (get_bb_piece(PieceTypes::KING, color) ^ get_bb_piece(PieceTypes::PAWN, color)) != get_bb_color(color);
@@ -503,11 +546,10 @@ class Board
     constexpr bool is_repetition(const int ply) const
     {
         int cnt = 1;
-        HistoricalState *temp_state = state;
-        for (int i = 2; i <= game_ply && i <= half_moves(); i += 2)
+        const int window = repetition_window();
+        for (int i = 2; i <= window; i += 2)
         {
-            temp_state = temp_state->prev->prev;
-            if (temp_state->key == key())
+            if (key_ago(i) == key())
             {
                 cnt++;
                 if (ply > i || cnt == 3)
@@ -517,6 +559,21 @@ class Board
         return false;
     }
 
+    // whether any position since the last irreversible move occurred before, the way the tablebase root probe expects
+    constexpr bool has_repeated() const
+    {
+        const int window = repetition_window();
+        for (int j = 0; j + 4 <= window; j++)
+        {
+            for (int i = j + 4; i <= window; i += 2)
+            {
+                if (key_ago(i) == key_ago(j))
+                    return true;
+            }
+        }
+        return false;
+    }
+
     constexpr bool is_draw(const int ply) const
     {
         if (half_moves() < 100 || !checkers())
@@ -528,16 +585,14 @@ class Board
     constexpr bool has_upcoming_repetition(const int ply) const
     {
         const Bitboard all_pieces = get_bb_color(WHITE) | get_bb_color(BLACK);
-        HistoricalState *temp_state = state->prev;
-        Key b = ~(key() ^ temp_state->key);
-        for (int i = 3; i <= half_moves() && i <= game_ply; i += 2)
+        const int window = repetition_window();
+        Key b = ~(key() ^ key_ago(1));
+        for (int i = 3; i <= window; i += 2)
         {
-            assert(temp_state->prev->prev);
-            temp_state = temp_state->prev->prev;
-            b ^= ~(temp_state->next->key ^ temp_state->key);
+            b ^= ~(key_ago(i - 1) ^ key_ago(i));
             if (b)
                 continue;
-            const Key key_delta = key() ^ temp_state->key;
+            const Key key_delta = key() ^ key_ago(i);
             int cuckoo_ind = cuckoo::hash1(key_delta);
 
             if (cuckoo::cuckoo[cuckoo_ind] != key_delta)
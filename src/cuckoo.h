@@ -25,21 +25,25 @@ namespace cuckoo
 constexpr int CUCKOO_SIZE = (1 << 13);
 constexpr int CUCKOO_MASK = CUCKOO_SIZE - 1;
 
-inline std::array<Key, CUCKOO_SIZE> cuckoo;
-inline std::array<Move, CUCKOO_SIZE> cuckoo_move;
-
-inline int hash1(const Key key)
+constexpr int hash1(const Key key)
 {
     return key & CUCKOO_MASK;
 }
-inline int hash2(const Key key)
+constexpr int hash2(const Key key)
 {
     return (key >> 16) & CUCKOO_MASK;
 }
 
-inline void init()
+struct CuckooTables
 {
-    int count = 0;
+    std::array<Key, CUCKOO_SIZE> keys;
+    std::array<Move, CUCKOO_SIZE> moves;
+    int count;
+};
+
+// computed at compile time from the zobrist keys
+inline constexpr CuckooTables cuckoo_tables = [] {
+    CuckooTables tables{};
     for (Piece piece = Pieces::BlackPawn; piece <= Pieces::WhiteKing; piece++)
     {
         // no pawns
@@ -47,27 +51,39 @@ inline void init()
             continue;
         for (Square from = 0; from < 64; from++)
         {
+            // attacks on an empty board
+            Bitboard att = piece.type() == PieceTypes::KNIGHT ? attacks::knightBBAttacks[from]
+                           : piece.type() == PieceTypes::KING ? attacks::kingBBAttacks[from]
+                                                              : Bitboard(0ull);
+            if (piece.type() == PieceTypes::BISHOP || piece.type() == PieceTypes::QUEEN)
+                att |= attacks::genAttacksBishopSlow(Bitboard(0ull), from);
+            if (piece.type() == PieceTypes::ROOK || piece.type() == PieceTypes::QUEEN)
+                att |= attacks::genAttacksRookSlow(Bitboard(0ull), from);
             for (Square to = from + 1; to < 64; to++)
             {
-                if (attacks::genAttacksSq(Bitboard(0ull), from, piece.type()).has_square(to))
+                if (att.has_square(to))
                 {
                     Move move = Move(from, to, NO_TYPE);
                     Key key = hashKey[piece][from] ^ hashKey[piece][to] ^ 1;
                     int cuckoo_ind = hash1(key);
                     while (true)
                     {
-                        std::swap(cuckoo[cuckoo_ind], key);
-                        std::swap(cuckoo_move[cuckoo_ind], move);
+                        std::swap(tables.keys[cuckoo_ind], key);
+                        std::swap(tables.moves[cuckoo_ind], move);
                         if (!move)
                             break;
                         cuckoo_ind = cuckoo_ind == hash1(key) ? hash2(key) : hash1(key);
                     }
-                    count++;
+                    tables.count++;
                 }
             }
         }
     }
-    assert(count == 3668);
-}
+    return tables;
+}();
+static_assert(cuckoo_tables.count == 3668);
+
+inline constexpr const std::array<Key, CUCKOO_SIZE> &cuckoo = cuckoo_tables.keys;
+inline constexpr const std::array<Move, CUCKOO_SIZE> &cuckoo_move = cuckoo_tables.moves;
 
 }; // namespace cuckoo
\ No newline at end of file
@@ -19,6 +19,7 @@
 #include "move.h"
 #include "params.h"
 #include "piece.h"
+#include "profiler.h"
 #include <array>
 #include <cassert>
 #include <chrono>
@@ -112,15 +113,9 @@ constexpr int STACK_SIZE = MAX_DEPTH + 5;
 
 inline const std::string START_POS_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
-inline std::map<char, Piece> cod;
-inline MultiArray<Key, 12, 64> hashKey;
-inline MultiArray<Key, 2, 2> castleKey;
-inline std::array<Key, 64> enPasKey;
-inline std::array<Key, 16> castleKeyModifier;
-
-inline MultiArray<Bitboard, 64, 64> between_mask, line_mask;
-
+#ifdef TUNE_FLAG
 inline MultiArray<int, 64, 64> lmr_red;
+#endif
 
 constexpr std::pair<int, int> knightDir[8] = {{-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}, {1, 2}, {2, 1}, {2, -1}, {1, -2}};
 constexpr std::pair<int, int> rookDir[4] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
@@ -160,9 +155,15 @@ class MeanValue
         count++;
     }
 
+    void merge(const MeanValue &other)
+    {
+        sum += other.sum;
+        count += other.count;
+    }
+
     void print_mean()
     {
-        std::cout << name << " has the mean value " << sum / count << " (" << count << " calls)\n";
+        std::cout << name << " has the mean value " << (count ? sum / count : 0.0) << " (" << count << " calls)\n";
     }
 };
 
@@ -172,14 +173,6 @@ constexpr int16_t net_index(Piece piece, Square sq, Square kingSq, bool side)
            (sq.mirror(side) ^ (7 * ((kingSq >> 2) & 1))); // kingSq should be ^7, if kingSq&7 >= 4
 }
 
-inline Key castle_rights_key(MultiArray<Square, 2, 2> rook_sq)
-{
-    return (castleKey[BLACK][0] * (rook_sq[BLACK][0] != NO_SQUARE)) ^
-           (castleKey[BLACK][1] * (rook_sq[BLACK][1] != NO_SQUARE)) ^
-           (castleKey[WHITE][0] * (rook_sq[WHITE][0] != NO_SQUARE)) ^
-           (castleKey[WHITE][1] * (rook_sq[WHITE][1] != NO_SQUARE));
-}
-
 constexpr bool recalc(Square from, Square to, bool side)
 {
     return (from & 4) != (to & 4) || kingIndTable[from.mirror(side)] != kingIndTable[to.mirror(side)];
@@ -202,38 +195,107 @@ constexpr bool inside_board(int rank, int file)
     return rank >= 0 && file >= 0 && rank <= 7 && file <= 7;
 }
 
-inline void init_defs()
-{
+// all the tables below are computed at compile time, so startup doesn't have to
+
+inline constexpr std::array<Piece, 256> cod = [] {
+    std::array<Piece, 256> cod{};
     cod['p'] = Pieces::BlackPawn, cod['n'] = Pieces::BlackKnight, cod['b'] = Pieces::BlackBishop;
     cod['r'] = Pieces::BlackRook, cod['q'] = Pieces::BlackQueen, cod['k'] = Pieces::BlackKing;
     cod['P'] = Pieces::WhitePawn, cod['N'] = Pieces::WhiteKnight, cod['B'] = Pieces::WhiteBishop;
     cod['R'] = Pieces::WhiteRook, cod['Q'] = Pieces::WhiteQueen, cod['K'] = Pieces::WhiteKing;
+    return cod;
+}();
+
+// constexpr std::mt19937_64, the zobrist keys are the ones the runtime generator used to produce
+class ConstexprMT64
+{
+  public:
+    constexpr ConstexprMT64(uint64_t seed) : index(N)
+    {
+        mt[0] = seed;
+        for (int i = 1; i < N; i++)
+            mt[i] = 6364136223846793005ULL * (mt[i - 1] ^ (mt[i - 1] >> 62)) + i;
+    }
+
+    constexpr uint64_t operator()()
+    {
+        if (index == N)
+            twist();
+        uint64_t z = mt[index++];
+        z ^= (z >> 29) & 0x5555555555555555ULL;
+        z ^= (z << 17) & 0x71D67FFFEDA60000ULL;
+        z ^= (z << 37) & 0xFFF7EEE000000000ULL;
+        return z ^ (z >> 43);
+    }
+
+  private:
+    static constexpr int N = 312, M = 156;
+    static constexpr uint64_t UPPER = ~0ULL << 31, LOWER = ~UPPER, MATRIX = 0xB5026F5AA96619E9ULL;
 
-    /// zobrist keys
+    constexpr void twist()
+    {
+        for (int i = 0; i < N; i++)
+        {
+            const uint64_t y = (mt[i] & UPPER) | (mt[(i + 1) % N] & LOWER);
+            mt[i] = mt[(i + M) % N] ^ (y >> 1) ^ ((y & 1) ? MATRIX : 0);
+        }
+        index = 0;
+    }
+
+    std::array<uint64_t, N> mt{};
+    int index;
+};
+
+struct ZobristKeys
+{
+    MultiArray<Key, 12, 64> hashKey;
+    MultiArray<Key, 2, 2> castleKey;
+    std::array<Key, 64> enPasKey;
+    std::array<Key, 16> castleKeyModifier;
+};
+
+inline constexpr ZobristKeys zobrist_keys = [] {
+    ZobristKeys keys{};
+    ConstexprMT64 gen(0xBEEF);
     for (auto i = Pieces::BlackPawn; i <= Pieces::WhiteKing; i++)
     {
         for (auto j = Squares::A1; j <= Squares::H8; j++)
-            hashKey[i][j] = rng(gen);
+            keys.hashKey[i][j] = gen();
     }
 
     for (int i = 0; i < 2; i++)
     {
         for (int j = 0; j < 2; j++)
-            castleKey[i][j] = rng(gen);
+            keys.castleKey[i][j] = gen();
     }
 
     for (int i = 0; i < (1 << 4); i++)
     {
         for (int j = 0; j < 4; j++)
-        {
-            castleKeyModifier[i] ^= castleKey[j / 2][j % 2] * ((i >> j) & 1);
-        }
+            keys.castleKeyModifier[i] ^= keys.castleKey[j / 2][j % 2] * ((i >> j) & 1);
     }
 
     for (int i = 0; i < 64; i++)
-        enPasKey[i] = rng(gen);
+        keys.enPasKey[i] = gen();
+    return keys;
+}();
+
+inline constexpr const MultiArray<Key, 12, 64> &hashKey = zobrist_keys.hashKey;
+inline constexpr const MultiArray<Key, 2, 2> &castleKey = zobrist_keys.castleKey;
+inline constexpr const std::array<Key, 64> &enPasKey = zobrist_keys.enPasKey;
+inline constexpr const std::array<Key, 16> &castleKeyModifier = zobrist_keys.castleKeyModifier;
 
-    /// mask squares between 2 squares
+inline Key castle_rights_key(MultiArray<Square, 2, 2> rook_sq)
+{
+    return (castleKey[BLACK][0] * (rook_sq[BLACK][0] != NO_SQUARE)) ^
+           (castleKey[BLACK][1] * (rook_sq[BLACK][1] != NO_SQUARE)) ^
+           (castleKey[WHITE][0] * (rook_sq[WHITE][0] != NO_SQUARE)) ^
+           (castleKey[WHITE][1] * (rook_sq[WHITE][1] != NO_SQUARE));
+}
+
+/// mask squares between 2 squares and the line through them
+inline constexpr std::array<MultiArray<Bitboard, 64, 64>, 2> between_and_line_masks = [] {
+    std::array<MultiArray<Bitboard, 64, 64>, 2> masks{};
     for (int file = 0; file < 8; file++)
     {
         for (int rank = 0; rank < 8; rank++)
@@ -248,7 +310,7 @@ inline void init_defs()
                     r += kingDir[i].first, f += kingDir[i].second;
                     if (!inside_board(r, f))
                         break;
-                    between_mask[Square(rank, file)][Square(r, f)] = mask;
+                    masks[0][Square(rank, file)][Square(r, f)] = mask;
                     int x = r, y = f, d = (i < 4 ? (i + 2) % 4 : 11 - i);
                     Bitboard mask2(0ull);
                     while (inside_board(x, y))
@@ -262,21 +324,42 @@ inline void init_defs()
                         mask2.set_bit(Square(x, y));
                         x += kingDir[d].first, y += kingDir[d].second;
                     }
-                    line_mask[Square(rank, file)][Square(r, f)] = mask | mask2;
+                    masks[1][Square(rank, file)][Square(r, f)] = mask | mask2;
 
                     mask.set_bit(Square(r, f));
                 }
             }
         }
     }
+    return masks;
+}();
+
+inline constexpr const MultiArray<Bitboard, 64, 64> &between_mask = between_and_line_masks[0];
+inline constexpr const MultiArray<Bitboard, 64, 64> &line_mask = between_and_line_masks[1];
+
+// natural logarithm usable in constant expressions, log(x) = 2 atanh((x - 1) / (x + 1)) after scaling x to [1, 2)
+constexpr double constexpr_log(double x)
+{
+    int e = 0;
+    while (x >= 2)
+        x /= 2, e++;
+    const double y = (x - 1) / (x + 1), y2 = y * y;
+    double term = y, sum = 0;
+    for (int k = 1; k < 60; k += 2)
+        sum += term / k, term *= y2;
+    return e * 0.693147180559945309417232121458176568 + 2 * sum;
+}
 
 #ifndef TUNE_FLAG
+inline constexpr MultiArray<int, 64, 64> lmr_red = [] {
+    MultiArray<int, 64, 64> lmr_red{};
     for (int i = 1; i < 64; i++)
     { /// depth
         for (int j = 1; j < 64; j++)
         { /// moves played
-            lmr_red[i][j] = LMRGrain * (LMRQuietBias + log(i) * log(j) / LMRQuietDiv);
+            lmr_red[i][j] = LMRGrain * (LMRQuietBias + constexpr_log(i) * constexpr_log(j) / LMRQuietDiv);
         }
     }
+    return lmr_red;
+}();
 #endif
-}
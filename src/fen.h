@@ -180,8 +180,8 @@ void Board::set_fen(const std::string fen, HistoricalState &next_state)
         nr = nr * 10 + fen[ind++] - '0';
     move_index() = nr;
 
-    get_pinned_pieces_and_checkers();
-    get_threats(turn);
+    reset_lazy_state();
+    push_key();
 }
 
 void Board::set_frc_side(bool color, int idx)
@@ -268,6 +268,6 @@ void Board::set_dfrc(int idx, HistoricalState &next_state)
     enpas() = NO_SQUARE;
     half_moves() = 0;
     move_index() = 1;
-    get_pinned_pieces_and_checkers();
-    get_threats(turn);
+    reset_lazy_state();
+    push_key();
 }
\ No newline at end of file
@@ -145,7 +145,11 @@ class PawnHistory
     int16_t hist;
 
   public:
+#ifdef COMPACT_HISTORY
+    static constexpr int SIZE = (1 << 9);
+#else
     static constexpr int SIZE = (1 << 12);
+#endif
     static constexpr int MASK = SIZE - 1;
 
     constexpr PawnHistory() = default;
@@ -186,7 +190,11 @@ class CorrectionHistory
     int16_t hist;
 
   public:
+#ifdef COMPACT_HISTORY
+    static constexpr int SIZE = (1 << 14);
+#else
     static constexpr int SIZE = (1 << 16);
+#endif
     static constexpr int MASK = SIZE - 1;
 
     constexpr CorrectionHistory() = default;
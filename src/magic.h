@@ -15,6 +15,7 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #pragma once
+#include <array>
 
 constexpr uint64_t rookMagics[64] = {
     0xa8002c000108020ULL,  0x6c00049b0002001ULL,  0x100200010090040ULL,  0x2480041000800801ULL, 0x280028004000800ULL,
@@ -55,3 +56,17 @@ constexpr int rookIndexBits[64] = {12, 11, 11, 11, 11, 11, 11, 12, 11, 10, 10, 1
 constexpr int bishopIndexBits[64] = {6, 5, 5, 5, 5, 5, 5, 6, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 7, 7, 7, 7,
                                      5, 5, 5, 5, 7, 9, 9, 7, 5, 5, 5, 5, 7, 9, 9, 7, 5, 5, 5, 5, 7, 7,
                                      7, 7, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 6, 5, 5, 5, 5, 5, 5, 6};
+
+// fancy magics: the attacks of every square are packed in one table, a square owning 2^index bits entries
+constexpr std::array<int, 64> get_table_offsets(const int (&index_bits)[64])
+{
+    std::array<int, 64> offsets{};
+    for (int sq = 1; sq < 64; sq++)
+        offsets[sq] = offsets[sq - 1] + (1 << index_bits[sq - 1]);
+    return offsets;
+}
+
+constexpr std::array<int, 64> rookTableOffset = get_table_offsets(rookIndexBits);
+constexpr std::array<int, 64> bishopTableOffset = get_table_offsets(bishopIndexBits);
+constexpr int ROOK_TABLE_SIZE = rookTableOffset[63] + (1 << rookIndexBits[63]);
+constexpr int BISHOP_TABLE_SIZE = bishopTableOffset[63] + (1 << bishopIndexBits[63]);
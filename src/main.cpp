@@ -30,24 +30,28 @@
 
 int main(int argc, char **argv)
 {
-    init_defs();
     attacks::init();
-    cuckoo::init();
     load_nnue_weights();
 
     if (argc > 1)
     {
 #ifndef GENERATE
+        if (!strncmp(argv[1], "benchsmp", 8))
+        {
+            UCI uci;
+            std::size_t threads = argc > 2 ? std::stoull(argv[2]) : 4;
+            int depth = argc > 3 ? std::stoi(argv[3]) : -1;
+            uci.bench_smp(threads, depth);
+            return 0;
+        }
         if (!strncmp(argv[1], "bench", 5))
         {
             UCI uci;
             int depth = -1;
-            if (argc > 2)
-            {
-                std::string s = argv[2];
-                depth = stoi(s);
-            }
-            uci.bench(depth);
+            bool perf = false;
+            for (int i = 2; i < argc; i++)
+                parse_bench_arg(argv[i], depth, perf);
+            uci.bench(depth, perf);
             return 0;
         }
 #else
@@ -24,10 +24,20 @@
 
 void Board::make_move(const Move move, HistoricalState &next_state)
 {
+    PROFILE_SCOPE(MAKE_MOVE);
+    if (turn == WHITE)
+        make_move<WHITE>(move, next_state);
+    else
+        make_move<BLACK>(move, next_state);
+}
+
+template <bool color> void Board::make_move(const Move move, HistoricalState &next_state)
+{
+    constexpr bool enemy = !color;
     Square from = move.get_from(), to = move.get_to();
     Piece piece = piece_at(from), piece_cap = piece_at(to);
 
-    memcpy(&next_state, state, sizeof(HistoricalState));
+    memcpy(&next_state, state, HISTORICAL_STATE_COPY_SIZE);
     next_state.prev = state;
     state->next = &next_state;
     state = &next_state;
@@ -52,26 +62,26 @@ void Board::make_move(const Move move, HistoricalState &next_state)
 
         move_from_to(from, to, piece);
         /// moved a castle rook
-        if (piece.type() == PieceTypes::ROOK && (from == rook_sq(turn, 0) || from == rook_sq(turn, 1)))
+        if (piece.type() == PieceTypes::ROOK && (from == rook_sq(color, 0) || from == rook_sq(color, 1)))
         {
-            rook_sq(turn, get_king(turn) < from) = NO_SQUARE;
+            rook_sq(color, get_king(color) < from) = NO_SQUARE;
         }
         else if (piece.type() == PieceTypes::KING)
-            rook_sq(turn, 0) = rook_sq(turn, 1) = NO_SQUARE;
+            rook_sq(color, 0) = rook_sq(color, 1) = NO_SQUARE;
 
         captured() = piece_cap;
 
         /// double push
         if (piece.type() == PieceTypes::PAWN && (from ^ to) == 16)
         {
-            if ((to % 8 && board[to - 1] == Piece(PieceTypes::PAWN, turn ^ 1)) ||
-                (to % 8 < 7 && board[to + 1] == Piece(PieceTypes::PAWN, turn ^ 1)))
-                enpas() = shift_square<NORTH>(turn, from), key() ^= enPasKey[enpas()];
+            if ((to % 8 && board[to - 1] == Piece(PieceTypes::PAWN, enemy)) ||
+                (to % 8 < 7 && board[to + 1] == Piece(PieceTypes::PAWN, enemy)))
+                enpas() = shift_square<NORTH>(color, from), key() ^= enPasKey[enpas()];
         }
 
         break;
     case MoveTypes::ENPASSANT: {
-        const Square pos = shift_square<SOUTH>(turn, to);
+        const Square pos = shift_square<SOUTH>(color, to);
         half_moves() = 0;
         move_from_to(from, to, piece);
         erase_square(pos);
@@ -80,17 +90,17 @@ void Board::make_move(const Move move, HistoricalState &next_state)
     break;
     case MoveTypes::CASTLE: {
         Square rFrom = to, rTo;
-        Piece rPiece(PieceTypes::ROOK, turn);
+        Piece rPiece(PieceTypes::ROOK, color);
 
         if (to > from)
         {
-            to = Squares::G1.mirror(turn);
-            rTo = Squares::F1.mirror(turn);
+            to = Squares::G1.mirror(color);
+            rTo = Squares::F1.mirror(color);
         }
         else
         {
-            to = Squares::C1.mirror(turn);
-            rTo = Squares::D1.mirror(turn);
+            to = Squares::C1.mirror(color);
+            rTo = Squares::D1.mirror(color);
         }
 
         move_from_to(rFrom, rTo, rPiece);
@@ -101,15 +111,15 @@ void Board::make_move(const Move move, HistoricalState &next_state)
         board[rTo] = rPiece;
 
         captured() = NO_PIECE;
-        rook_sq(turn, 0) = rook_sq(turn, 1) = NO_SQUARE;
+        rook_sq(color, 0) = rook_sq(color, 1) = NO_SQUARE;
     }
 
     break;
     default: /// promotion
     {
-        Piece prom_piece(move.get_prom() + PieceTypes::KNIGHT, turn);
+        Piece prom_piece(move.get_prom() + PieceTypes::KNIGHT, color);
 
-        pieces[turn] ^= Bitboard(from) ^ Bitboard(to);
+        pieces[color] ^= Bitboard(from) ^ Bitboard(to);
         bb[piece] ^= Bitboard(from);
         bb[prom_piece] ^= Bitboard(to);
 
@@ -134,13 +144,14 @@ void Board::make_move(const Move move, HistoricalState &next_state)
     ply++;
     game_ply++;
     key() ^= 1;
-    move_index() += turn == WHITE;
-    get_pinned_pieces_and_checkers();
-    get_threats(turn);
+    move_index() += color == BLACK;
+    reset_lazy_state();
+    push_key();
 }
 
 void Board::undo_move(const Move move)
 {
+    PROFILE_SCOPE(UNDO_MOVE);
     turn ^= 1;
     ply--;
     game_ply--;
@@ -230,7 +241,7 @@ void Board::undo_move(const Move move)
 
 void Board::make_null_move(HistoricalState &next_state)
 {
-    memcpy(&next_state, state, sizeof(HistoricalState));
+    memcpy(&next_state, state, HISTORICAL_STATE_COPY_SIZE);
     next_state.prev = state;
     state->next = &next_state;
     state = &next_state;
@@ -241,12 +252,12 @@ void Board::make_null_move(HistoricalState &next_state)
     enpas() = NO_SQUARE;
     turn ^= 1;
     key() ^= 1;
-    get_pinned_pieces_and_checkers();
-    get_threats(turn);
+    reset_lazy_state();
     ply++;
     game_ply++;
     half_moves()++;
     move_index()++;
+    push_key();
 }
 
 void Board::undo_null_move()
@@ -272,13 +283,19 @@ inline void add_promotions(MoveList &moves, int &nr_moves, Square from, Square t
 }
 
 template <int movegen_type> constexpr int Board::gen_legal_moves(MoveList &moves) const
+{
+    PROFILE_SCOPE(GEN_LEGAL_MOVES);
+    return turn == WHITE ? gen_legal_moves<movegen_type, WHITE>(moves) : gen_legal_moves<movegen_type, BLACK>(moves);
+}
+
+template <int movegen_type, bool color> constexpr int Board::gen_legal_moves(MoveList &moves) const
 {
     constexpr bool noisy_movegen = movegen_type & MOVEGEN_NOISY;
     constexpr bool quiet_movegen = movegen_type & MOVEGEN_QUIET;
 
     int nrMoves = 0;
-    const bool color = turn, enemy = color ^ 1;
-    const int rank7 = color == WHITE ? 6 : 1, rank3 = color == WHITE ? 2 : 5;
+    constexpr bool enemy = !color;
+    constexpr int rank7 = color == WHITE ? 6 : 1, rank3 = color == WHITE ? 2 : 5;
     const Square king = get_king(color);
     Bitboard our_pawns = get_bb_piece(PieceTypes::PAWN, color);
     Bitboard mask, us = get_bb_color(color), them = get_bb_color(enemy);
@@ -478,7 +495,7 @@ template <int movegen_type> constexpr int Board::gen_legal_moves(MoveList &moves
     if constexpr (noisy_movegen)
     {
         b2 = shift_mask<NORTHWEST>(color, b1 & not_edge_mask[enemy]) & capMask;
-        b3 = shift_mask<NORTHEAST>(color, b1 & not_edge_mask[turn]) & capMask;
+        b3 = shift_mask<NORTHEAST>(color, b1 & not_edge_mask[color]) & capMask;
 
         // captures
         while (b2)
@@ -501,7 +518,7 @@ template <int movegen_type> constexpr int Board::gen_legal_moves(MoveList &moves
         }
 
         b2 = shift_mask<NORTHWEST>(color, b1 & not_edge_mask[enemy]) & capMask;
-        b3 = shift_mask<NORTHEAST>(color, b1 & not_edge_mask[turn]) & capMask;
+        b3 = shift_mask<NORTHEAST>(color, b1 & not_edge_mask[color]) & capMask;
         while (b2)
         {
             Square sq = b2.get_square_pop();
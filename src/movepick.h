@@ -47,7 +47,35 @@ enum Stages : int
     STAGE_PC_NOISY,
 }; /// move picker stages
 
-bool see(Board &board, Move move, int threshold);
+// static exchange evaluation for the moves of one node
+// the attackers of a square don't depend on the move, so they are computed once per target square
+class SEEContext
+{
+  public:
+    SEEContext(const Board &board)
+        : board(board), diag(board.diagonal_sliders(WHITE) | board.diagonal_sliders(BLACK)),
+          orth(board.orthogonal_sliders(WHITE) | board.orthogonal_sliders(BLACK)),
+          all(board.get_bb_color(WHITE) | board.get_bb_color(BLACK)), ready(0ull)
+    {
+    }
+
+    bool see(const Move move, const int threshold);
+
+  private:
+    Bitboard attackers_to(const Square sq)
+    {
+        if (!ready.has_square(sq))
+        {
+            attackers[sq] = board.get_attackers(WHITE, all, sq) | board.get_attackers(BLACK, all, sq);
+            ready |= Bitboard(sq);
+        }
+        return attackers[sq];
+    }
+
+    const Board &board;
+    Bitboard diag, orth, all, ready;
+    std::array<Bitboard, 64> attackers;
+};
 
 class Movepick
 {
@@ -61,6 +89,7 @@ class Movepick
 
     Bitboard all_threats, threats_p, threats_bn, threats_r;
     int threshold;
+    SEEContext *see_context;
 
     MoveList moves, badNoisy;
     std::array<int, MAX_MOVES> scores;
@@ -74,9 +103,11 @@ class Movepick
 
   public:
     // Normal Movepicker, used in PVS search.
-    Movepick(const Move tt_move, const Move killer, const Move kp_move, const int threshold, const Threats threats)
+    Movepick(const Move tt_move, const Move killer, const Move kp_move, const int threshold, const Threats threats,
+             SEEContext &see_context)
         : tt_move(tt_move), killer(killer != tt_move ? killer : NULLMOVE),
-          kp_move(kp_move != killer && kp_move != tt_move ? kp_move : NULLMOVE), threshold(threshold)
+          kp_move(kp_move != killer && kp_move != tt_move ? kp_move : NULLMOVE), threshold(threshold),
+          see_context(&see_context)
     {
         stage = STAGE_TTMOVE;
         nrNoisy = nrQuiets = nrBadNoisy = 0;
@@ -89,7 +120,7 @@ class Movepick
     }
 
     // QS Movepicker
-    Movepick(const Move tt_move, const Threats threats, const bool in_check) : tt_move(tt_move)
+    Movepick(const Move tt_move, const Threats threats, const bool in_check) : tt_move(tt_move), see_context(nullptr)
     {
         stage = STAGE_QS_TTMOVE + !tt_move;
         nrNoisy = nrQuiets = 0;
@@ -102,7 +133,8 @@ class Movepick
     }
 
     // Probcut Movepicker
-    Movepick(const Move tt_move, const int threshold, const Threats threats) : tt_move(tt_move), threshold(threshold)
+    Movepick(const Move tt_move, const int threshold, const Threats threats, SEEContext &see_context)
+        : tt_move(tt_move), threshold(threshold), see_context(&see_context)
     {
         stage = STAGE_PC_TTMOVE;
         nrNoisy = 0;
@@ -121,6 +153,7 @@ class Movepick
 
     void get_best_move(int offset, int nrMoves, MoveList &moves, std::array<int, MAX_MOVES> &scores)
     {
+        PROFILE_SCOPE(MOVEPICK_SELECT);
         int ind = offset;
         for (int i = offset + 1; i < nrMoves; i++)
         {
@@ -142,6 +175,7 @@ class Movepick
                 return tt_move;
         }
         case Stages::STAGE_GEN_NOISY: {
+            PROFILE_SCOPE(MOVEPICK_GEN_NOISY);
             nrNoisy = board.gen_legal_moves<MOVEGEN_NOISY>(moves);
             int m = 0;
             for (int i = 0; i < nrNoisy; i++)
@@ -173,7 +207,7 @@ class Movepick
             while (index < nrNoisy)
             {
                 get_best_move(index, nrNoisy, moves, scores);
-                if (see(board, moves[index], threshold))
+                if (see_context->see(moves[index], threshold))
                     return moves[index++];
                 else
                 {
@@ -195,6 +229,7 @@ class Movepick
         case Stages::STAGE_GEN_QUIETS: {
             if (!skip_quiets_flag)
             {
+                PROFILE_SCOPE(MOVEPICK_GEN_QUIETS);
                 nrQuiets = board.gen_legal_moves<MOVEGEN_QUIET>(moves);
                 const bool turn = board.turn, enemy = 1 ^ turn;
                 const Bitboard allPieces = board.get_bb_color(WHITE) | board.get_bb_color(BLACK);
@@ -287,6 +322,7 @@ class Movepick
                 return tt_move;
         }
         case Stages::STAGE_QS_GEN_NOISY: {
+            PROFILE_SCOPE(MOVEPICK_GEN_NOISY);
             nrNoisy = board.gen_legal_moves<MOVEGEN_NOISY>(moves);
             int m = 0;
             for (int i = 0; i < nrNoisy; i++)
@@ -323,6 +359,7 @@ class Movepick
             stage++;
         }
         case Stages::STAGE_QS_GEN_QUIETS: {
+            PROFILE_SCOPE(MOVEPICK_GEN_QUIETS);
             nrQuiets = board.gen_legal_moves<MOVEGEN_QUIET>(moves);
             const bool turn = board.turn;
             const Key pawn_key = board.pawn_key();
@@ -365,6 +402,7 @@ class Movepick
                 return tt_move;
         }
         case Stages::STAGE_PC_GEN_NOISY: {
+            PROFILE_SCOPE(MOVEPICK_GEN_NOISY);
             nrNoisy = board.gen_legal_moves<MOVEGEN_NOISY>(moves);
             int m = 0;
             for (int i = 0; i < nrNoisy; i++)
@@ -393,7 +431,7 @@ class Movepick
             while (index < nrNoisy)
             {
                 get_best_move(index, nrNoisy, moves, scores);
-                if (see(board, moves[index], threshold))
+                if (see_context->see(moves[index], threshold))
                     return moves[index++];
                 else
                     index++;
@@ -409,11 +447,12 @@ class Movepick
     }
 };
 
-bool see(Board &board, Move move, int threshold)
+bool SEEContext::see(const Move move, const int threshold)
 {
+    PROFILE_SCOPE(SEE);
     Square from = move.get_from(), to = move.get_to();
     int score = -threshold + 1;
-    Bitboard diag, orth, occ, att, myAtt, b;
+    Bitboard occ, att, myAtt, b;
     bool stm, result = 1;
 
     score += seeVal[board.get_captured_type(move)];
@@ -426,16 +465,22 @@ bool see(Board &board, Move move, int threshold)
     if (score <= 0)
         return 1;
 
-    diag = board.diagonal_sliders(WHITE) | board.diagonal_sliders(BLACK);
-    orth = board.orthogonal_sliders(WHITE) | board.orthogonal_sliders(BLACK);
-
-    occ = board.get_bb_color(WHITE) | board.get_bb_color(BLACK);
-    occ = (occ ^ Bitboard(from)) | Bitboard(to);
+    occ = (all ^ Bitboard(from)) | Bitboard(to);
 
     if (move.get_type() == MoveTypes::ENPASSANT && board.enpas() != NO_SQUARE)
+    {
         occ ^= Bitboard(board.enpas());
-
-    att = board.get_attackers(WHITE, occ, to) | board.get_attackers(BLACK, occ, to);
+        att = board.get_attackers(WHITE, occ, to) | board.get_attackers(BLACK, occ, to);
+    }
+    else
+    {
+        // lifting the moving piece can only uncover sliders on the line through it
+        att = attackers_to(to);
+        if (attacks::genAttacksBishop(Bitboard(0ull), to).has_square(from))
+            att |= attacks::genAttacksBishop(occ, to) & diag;
+        else if (attacks::genAttacksRook(Bitboard(0ull), to).has_square(from))
+            att |= attacks::genAttacksRook(occ, to) & orth;
+    }
 
     stm = board.turn;
 
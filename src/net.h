@@ -405,6 +405,7 @@ class Network
 
     void bring_up_to_date(Board &board)
     {
+        PROFILE_SCOPE(EVAL_UPDATE);
         for (auto side : {BLACK, WHITE})
         {
             if (!hist[hist_size - 1].calc[side])
@@ -449,6 +450,7 @@ class Network
 
     int32_t get_output(bool stm, int output_bucket)
     {
+        PROFILE_SCOPE(EVAL_OUTPUT);
         reg_type_s acc{};
         const reg_type *w = reinterpret_cast<const reg_type *>(&output_history[hist_size - 1][stm * SIDE_NEURONS]);
         const reg_type *w2 =
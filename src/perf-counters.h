@@ -0,0 +1,174 @@
+/*
+  Clover is a UCI chess playing engine authored by Luca Metehau.
+  <https://github.com/lucametehau/CloverEngine>
+
+  Clover is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Clover is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <array>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// hardware performance counters read around bench, only available on linux
+// counters are opened before the search threads are created, so that they are inherited by them
+enum PerfEvents : int
+{
+    CYCLES = 0,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    DTLB_MISSES,
+    BRANCH_MISSES,
+    PERF_EVENTS_COUNT
+};
+
+const std::array<std::string, PerfEvents::PERF_EVENTS_COUNT> perf_event_names = {
+    "cycles", "instructions", "L1D misses", "LLC misses", "dTLB misses", "branch misses"};
+
+class PerfCounters
+{
+  private:
+    std::array<int, PerfEvents::PERF_EVENTS_COUNT> fds;
+    std::array<uint64_t, PerfEvents::PERF_EVENTS_COUNT> values;
+
+#ifdef __linux__
+    static constexpr uint64_t cache_event(uint64_t cache)
+    {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+    int open_event(uint32_t type, uint64_t config)
+    {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+
+  public:
+    PerfCounters()
+    {
+        fds.fill(-1);
+        values.fill(0);
+    }
+    ~PerfCounters()
+    {
+        close();
+    }
+
+    // returns false if no counter could be opened (not permitted, not supported or not linux)
+    bool open()
+    {
+        bool any = false;
+#ifdef __linux__
+        const std::array<std::pair<uint32_t, uint64_t>, PerfEvents::PERF_EVENTS_COUNT> events = {{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D)},
+            {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_LL)},
+            {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_DTLB)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        }};
+        for (int i = 0; i < PerfEvents::PERF_EVENTS_COUNT; i++)
+        {
+            fds[i] = open_event(events[i].first, events[i].second);
+            any |= fds[i] != -1;
+        }
+#endif
+        return any;
+    }
+
+    void close()
+    {
+#ifdef __linux__
+        for (auto &fd : fds)
+        {
+            if (fd != -1)
+                ::close(fd);
+            fd = -1;
+        }
+#endif
+    }
+
+    void start()
+    {
+#ifdef __linux__
+        for (auto fd : fds)
+        {
+            if (fd != -1)
+            {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    void stop()
+    {
+#ifdef __linux__
+        for (int i = 0; i < PerfEvents::PERF_EVENTS_COUNT; i++)
+        {
+            if (fds[i] == -1)
+                continue;
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            // value, time enabled, time running (scale the value if the counter was multiplexed)
+            uint64_t data[3] = {0, 0, 0};
+            if (read(fds[i], data, sizeof(data)) != sizeof(data))
+            {
+                ::close(fds[i]);
+                fds[i] = -1;
+                continue;
+            }
+            values[i] = data[2] ? static_cast<uint64_t>(1.0 * data[0] * data[1] / data[2]) : data[0];
+        }
+#endif
+    }
+
+    void print(uint64_t nodes)
+    {
+        nodes = std::max<uint64_t>(nodes, 1);
+        for (int i = 0; i < PerfEvents::PERF_EVENTS_COUNT; i++)
+        {
+            std::cout << std::left << std::setw(16) << perf_event_names[i] << std::right;
+            if (fds[i] == -1)
+                std::cout << std::setw(16) << "n/a" << "\n";
+            else
+                std::cout << std::setw(16) << values[i] << std::setw(12) << std::fixed << std::setprecision(3)
+                          << 1.0 * values[i] / nodes << " per node\n";
+        }
+        if (fds[PerfEvents::CYCLES] != -1 && fds[PerfEvents::INSTRUCTIONS] != -1)
+        {
+            std::cout << "IPC " << std::fixed << std::setprecision(3)
+                      << 1.0 * values[PerfEvents::INSTRUCTIONS] / std::max<uint64_t>(values[PerfEvents::CYCLES], 1)
+                      << "\n";
+        }
+        std::cout << std::flush;
+    }
+};
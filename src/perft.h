@@ -16,28 +16,203 @@
 */
 #pragma once
 #include "movegen.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
-template <bool RootNode, bool Chess960> uint64_t perft(Board &board, int depth)
+// Shared perft hash, keyed by zobrist key and depth, filled without locks: each entry keeps the node count
+// packed with the depth, next to that value xored with the key, so entries torn by concurrent writes don't match.
+class PerftTable
 {
+  private:
+    struct Entry
+    {
+        std::atomic<uint64_t> check, data;
+    };
+    std::unique_ptr<Entry[]> table;
+    uint64_t size;
+
+    Entry &entry(const Key key, const int depth)
+    {
+        using uint128_t = unsigned __int128;
+        const uint64_t hash = key ^ (depth * 0x9E3779B97F4A7C15ULL);
+        return table[(static_cast<uint128_t>(hash) * size) >> 64];
+    }
+
+  public:
+    PerftTable(uint64_t bytes) : size(bytes / sizeof(Entry))
+    {
+        if (size)
+            table = std::make_unique<Entry[]>(size);
+    }
+
+    bool enabled() const
+    {
+        return size != 0;
+    }
+
+    bool probe(const Key key, const int depth, uint64_t &nodes)
+    {
+        Entry &e = entry(key, depth);
+        const uint64_t data = e.data.load(std::memory_order_relaxed);
+        if ((e.check.load(std::memory_order_relaxed) ^ data) != key || static_cast<int>(data & 255) != depth)
+            return false;
+        nodes = data >> 8;
+        return true;
+    }
+
+    void save(const Key key, const int depth, const uint64_t nodes)
+    {
+        Entry &e = entry(key, depth);
+        const uint64_t data = nodes << 8 | depth;
+        e.data.store(data, std::memory_order_relaxed);
+        e.check.store(key ^ data, std::memory_order_relaxed);
+    }
+};
+
+// leaves are counted in bulk, the number of legal moves at depth 1 being the number of nodes
+template <bool Chess960> uint64_t perft(Board &board, int depth, PerftTable *table = nullptr)
+{
+    if (depth <= 0)
+        return 1;
+
+    // probe before generating the moves, which a hit doesn't need; depth 1 isn't worth a probe
+    uint64_t nodes = 0;
+    const bool hashed = depth > 1 && table && table->enabled();
+    if (hashed && table->probe(board.key(), depth, nodes))
+        return nodes;
+
     MoveList moves;
     int nrMoves = board.gen_legal_moves<MOVEGEN_ALL>(moves);
     if (depth == 1)
         return nrMoves;
 
-    uint64_t nodes = 0;
-
     HistoricalState next_state;
     for (int i = 0; i < nrMoves; i++)
     {
         Move move = moves[i];
-        // Board new_board = board;
         board.make_move(move, next_state);
-        uint64_t x;
-        x = perft<false, Chess960>(board, depth - 1);
-        nodes += x;
+        nodes += perft<Chess960>(board, depth - 1, table);
         board.undo_move(move);
-        if constexpr (RootNode)
-            std::cout << move.to_string(Chess960) << ": " << x << "\n";
     }
+    if (hashed)
+        table->save(board.key(), depth, nodes);
     return nodes;
 }
+
+// the root moves are handed out to the threads through a shared counter, returns the node count of each of them
+template <bool Chess960>
+std::vector<std::pair<Move, uint64_t>> perft_divide(Board &board, int depth, int nr_threads,
+                                                    PerftTable *table = nullptr)
+{
+    MoveList moves;
+    const int nr_moves = board.gen_legal_moves<MOVEGEN_ALL>(moves);
+    std::vector<std::pair<Move, uint64_t>> divide(nr_moves);
+    std::atomic<int> next_move{0};
+
+    auto worker = [&]() {
+        // private copies of the board and of its current state, which make_move links to the next one
+        Board thread_board;
+        HistoricalState root_state, next_state;
+        memcpy(&thread_board, &board, sizeof(Board));
+        memcpy(&root_state, board.state, sizeof(HistoricalState));
+        thread_board.state = &root_state;
+        for (int i; (i = next_move.fetch_add(1, std::memory_order_relaxed)) < nr_moves;)
+        {
+            thread_board.make_move(moves[i], next_state);
+            divide[i] = {moves[i], perft<Chess960>(thread_board, depth - 1, table)};
+            thread_board.undo_move(moves[i]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < nr_threads; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads)
+        thread.join();
+    return divide;
+}
+
+// a position of a perft suite, with the expected node count at each depth
+struct PerftSuiteEntry
+{
+    std::string fen;
+    std::vector<std::pair<int, uint64_t>> expected;
+    std::vector<uint64_t> found;
+    uint64_t nodes = 0;
+};
+
+// reads EPD lines like "<fen> ;D1 20 ;D2 400", the fen having 4 or 6 fields
+inline std::vector<PerftSuiteEntry> read_perft_suite(const std::string &path, int max_depth)
+{
+    std::vector<PerftSuiteEntry> suite;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream iss(line);
+        std::string fen, field;
+        std::getline(iss, fen, ';');
+        std::istringstream fen_iss(fen);
+        PerftSuiteEntry entry;
+        int fields = 0;
+        while (fen_iss >> field)
+            entry.fen += field + " ", fields++;
+        if (fields < 4)
+            continue;
+        if (fields == 4)
+            entry.fen += "0 1 ";
+
+        while (std::getline(iss, field, ';'))
+        {
+            std::istringstream depth_iss(field);
+            std::string depth;
+            uint64_t nodes;
+            // entries with a depth below 1 are ignored, there is nothing to check at the root
+            if (depth_iss >> depth >> nodes && depth.size() > 1 && depth[0] == 'D' &&
+                std::all_of(depth.begin() + 1, depth.end(), [](char c) { return std::isdigit(c); }))
+            {
+                const int d = std::stoi(depth.substr(1));
+                if (d >= 1 && d <= max_depth)
+                    entry.expected.emplace_back(d, nodes);
+            }
+        }
+        suite.push_back(entry);
+    }
+    return suite;
+}
+
+// runs the positions in parallel, each thread taking the next unchecked position
+template <bool Chess960> void run_perft_suite(std::vector<PerftSuiteEntry> &suite, int nr_threads)
+{
+    std::atomic<std::size_t> next_entry{0};
+    auto worker = [&]() {
+        for (std::size_t i; (i = next_entry.fetch_add(1, std::memory_order_relaxed)) < suite.size();)
+        {
+            PerftSuiteEntry &entry = suite[i];
+            Board board;
+            HistoricalState state;
+            board.set_fen(entry.fen, state);
+            for (auto &[depth, expected] : entry.expected)
+            {
+                entry.found.push_back(perft<Chess960>(board, depth));
+                entry.nodes += entry.found.back();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < nr_threads; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads)
+        thread.join();
+}
@@ -46,22 +46,22 @@ class Piece
         return piece - other;
     }
 
-    Piece &operator+=(const Piece &other)
+    constexpr Piece &operator+=(const Piece &other)
     {
         piece += other.piece;
         return *this;
     }
-    Piece &operator-=(const Piece &other)
+    constexpr Piece &operator-=(const Piece &other)
     {
         piece -= other.piece;
         return *this;
     }
-    Piece &operator++()
+    constexpr Piece &operator++()
     {
         piece++;
         return *this;
     }
-    Piece operator++(int)
+    constexpr Piece operator++(int)
     {
         Piece temp = *this;
         piece++;
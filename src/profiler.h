@@ -0,0 +1,173 @@
+/*
+  Clover is a UCI chess playing engine authored by Luca Metehau.
+  <https://github.com/lucametehau/CloverEngine>
+
+  Clover is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Clover is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// scoped cycle counter profiler, only compiled in with -DPROFILER
+// the times are inclusive, e.g. gen_legal_moves is also part of the movepicker generation stages
+enum ProfileZones : int
+{
+    MAKE_MOVE = 0,
+    UNDO_MOVE,
+    GEN_LEGAL_MOVES,
+    MOVEPICK_GEN_NOISY,  // generating and scoring noisy moves
+    MOVEPICK_GEN_QUIETS, // generating and scoring quiet moves
+    MOVEPICK_SELECT,     // selecting the best remaining move
+    SEE,
+    EVAL_UPDATE, // bringing the accumulators up to date
+    EVAL_OUTPUT,
+    TT_PROBE,
+    TT_SAVE,
+    PROBE_TB,
+    ZONES_COUNT
+};
+
+namespace profiler
+{
+const std::array<std::string, ProfileZones::ZONES_COUNT> zone_names = {
+    "make_move", "undo_move", "gen_legal_moves", "movepick gen noisy", "movepick gen quiets", "movepick select", "see",
+    "eval update", "eval output", "tt probe", "tt save", "probe_TB"};
+
+inline uint64_t read_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+struct ThreadData
+{
+    std::array<uint64_t, ProfileZones::ZONES_COUNT> cycles{}, calls{};
+};
+
+inline void accumulate(ThreadData &total, const ThreadData &data)
+{
+    for (int i = 0; i < ProfileZones::ZONES_COUNT; i++)
+    {
+        total.cycles[i] += data.cycles[i];
+        total.calls[i] += data.calls[i];
+    }
+}
+
+// counters of the running threads, and the sum of those of the threads that already exited
+inline std::mutex registry_mutex;
+inline std::vector<ThreadData *> registry;
+inline ThreadData retired;
+inline uint64_t session_start = 0;
+
+// the counters of a thread, registered while the thread lives and folded into retired when it exits
+class ThreadRegistration
+{
+  public:
+    ThreadData data;
+
+    ThreadRegistration()
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.push_back(&data);
+    }
+    ~ThreadRegistration()
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        accumulate(retired, data);
+        registry.erase(std::find(registry.begin(), registry.end(), &data));
+    }
+};
+
+inline ThreadData &local_data()
+{
+    thread_local ThreadRegistration registration;
+    return registration.data;
+}
+
+inline void reset()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (auto data : registry)
+        *data = ThreadData();
+    retired = ThreadData();
+    session_start = read_cycles();
+}
+
+inline void print(uint64_t nodes)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    ThreadData total = retired;
+    for (auto data : registry)
+        accumulate(total, *data);
+    const uint64_t elapsed = std::max<uint64_t>(1, read_cycles() - session_start);
+
+    std::cout << std::left << std::setw(22) << "zone" << std::right << std::setw(14) << "calls" << std::setw(14)
+              << "cycles/call" << std::setw(14) << "cycles/node" << std::setw(10) << "% time" << "\n";
+    for (int i = 0; i < ProfileZones::ZONES_COUNT; i++)
+    {
+        std::cout << std::left << std::setw(22) << zone_names[i] << std::right << std::setw(14) << total.calls[i]
+                  << std::setw(14) << total.cycles[i] / std::max<uint64_t>(1, total.calls[i]) << std::setw(14)
+                  << total.cycles[i] / std::max<uint64_t>(1, nodes) << std::setw(10) << std::fixed
+                  << std::setprecision(2) << 100.0 * total.cycles[i] / elapsed << "\n";
+    }
+    std::cout << std::flush;
+}
+
+class Scope
+{
+  private:
+    int zone;
+    uint64_t start;
+
+  public:
+    // usable in constexpr functions, only measuring at runtime
+    constexpr Scope(int zone) : zone(zone), start(0)
+    {
+        if (!std::is_constant_evaluated())
+            start = read_cycles();
+    }
+    constexpr ~Scope()
+    {
+        if (!std::is_constant_evaluated())
+        {
+            ThreadData &data = local_data();
+            data.cycles[zone] += read_cycles() - start;
+            data.calls[zone]++;
+        }
+    }
+};
+} // namespace profiler
+
+#ifdef PROFILER
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(zone) profiler::Scope PROFILE_CONCAT(profile_scope_, __LINE__)(ProfileZones::zone)
+#else
+#define PROFILE_SCOPE(zone)
+#endif
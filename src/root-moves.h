@@ -45,9 +45,10 @@ class RootMoves
   public:
     RootMoves() = default;
 
-    RootMoves(MoveList &moves, int nr_moves)
+    // with groups > 1, only keep the moves belonging to the given group (MultiPV split between threads)
+    RootMoves(MoveList &moves, int nr_moves, int groups = 1, int group = 0)
     {
-        for (int i = 0; i < nr_moves; i++)
+        for (int i = group; i < nr_moves; i += groups)
             root_moves.push_back(RootMove(moves[i]));
     }
 
@@ -57,6 +58,12 @@ class RootMoves
                              [move](const RootMove &rm) { return rm.pv[0] == move; });
     }
 
+    const bool has_move(Move move) const
+    {
+        return std::any_of(root_moves.begin(), root_moves.end(),
+                           [move](const RootMove &rm) { return rm.pv[0] == move; });
+    }
+
     const bool move_was_searched(Move move) const
     {
         return std::any_of(root_moves.begin(), root_moves.end(),
@@ -84,4 +91,9 @@ class RootMoves
     {
         return root_moves.empty();
     }
+
+    const int size() const
+    {
+        return root_moves.size();
+    }
 };
\ No newline at end of file
@@ -11,21 +11,31 @@ inline std::time_t get_current_time()
     return std::chrono::duration_cast<std::chrono::milliseconds>(t - t_init).count();
 }
 
+// time used on a move over its soft limit, as the iteration in progress is finished, measured in sudden death
+constexpr double TM_SOFT_LIMIT_OVERSHOOT = 1.3;
+
 class Info
 {
   private:
     std::time_t start_time;
     std::time_t recommended_soft_limit, soft_limit, hard_limit;
-    int depth, multipv;
+    int depth, multipv, multipv_groups;
+    int skip_schedule;
     int64_t nodes_lim, min_nodes, max_nodes;
+    int64_t nodes_time;
 
     bool timeset, chess960;
     bool nodes_are_min_nodes;
+    bool multipv_split;
+    bool abdada;
+    bool best_thread_voting;
+    bool deterministic;
 
   public:
     Info()
-        : depth(MAX_DEPTH), multipv(1), nodes_lim(-1), min_nodes(-1), max_nodes(-1), chess960(false),
-          nodes_are_min_nodes(false)
+        : depth(MAX_DEPTH), multipv(1), multipv_groups(1), skip_schedule(0), nodes_lim(-1), min_nodes(-1),
+          max_nodes(-1), nodes_time(0), chess960(false), nodes_are_min_nodes(false), multipv_split(false),
+          abdada(false), best_thread_voting(false), deterministic(false)
     {
     }
 
@@ -49,6 +59,34 @@ class Info
     {
         return chess960;
     }
+    constexpr bool is_multipv_split() const
+    {
+        return multipv_split;
+    }
+    constexpr int get_multipv_groups() const
+    {
+        return multipv_groups;
+    }
+    constexpr bool is_abdada() const
+    {
+        return abdada;
+    }
+    constexpr int get_skip_schedule() const
+    {
+        return skip_schedule;
+    }
+    constexpr bool is_best_thread_voting() const
+    {
+        return best_thread_voting;
+    }
+    constexpr bool is_deterministic() const
+    {
+        return deterministic;
+    }
+    constexpr int64_t get_nodes_time() const
+    {
+        return nodes_time;
+    }
 
     void set_soft_limit(std::time_t time)
     {
@@ -95,12 +133,49 @@ class Info
     {
         chess960 = _chess960;
     }
+    void set_multipv_split(bool _multipv_split)
+    {
+        multipv_split = _multipv_split;
+    }
+    void set_multipv_groups(int _multipv_groups)
+    {
+        multipv_groups = _multipv_groups;
+    }
+    void set_abdada(bool _abdada)
+    {
+        abdada = _abdada;
+    }
+    void set_skip_schedule(int _skip_schedule)
+    {
+        skip_schedule = _skip_schedule;
+    }
+    void set_best_thread_voting(bool _best_thread_voting)
+    {
+        best_thread_voting = _best_thread_voting;
+    }
+    void set_deterministic(bool _deterministic)
+    {
+        deterministic = _deterministic;
+    }
+    // nodes per millisecond used instead of the clock, 0 to use the clock
+    void set_nodes_time(int64_t _nodes_time)
+    {
+        nodes_time = _nodes_time;
+    }
 
-    void set_time(std::time_t time, std::time_t inc)
+    void set_time(std::time_t time, std::time_t inc, int movestogo = 0)
     {
         std::time_t time_with_inc = time + 40 * inc;
+        double coef = TMCoef1;
+        // the time has to last for movestogo moves, instead of a share of the rest of the game,
+        // so it is spread evenly over them, accounting for the soft limit overshoot
+        if (movestogo > 0)
+        {
+            time_with_inc = time + (movestogo - 1) * inc;
+            coef = 1.0 / (TM_SOFT_LIMIT_OVERSHOOT * movestogo);
+        }
         timeset = true;
-        soft_limit = std::min<int>(time_with_inc * TMCoef1, time * TMCoef2);
+        soft_limit = std::min<int>(time_with_inc * coef, time * TMCoef2);
         hard_limit = std::min<int>(soft_limit * TMCoef3, time * TMCoef4);
     }
 
@@ -116,13 +191,29 @@ class Info
         return get_current_time() - start_time;
     }
 
-    const bool soft_limit_passed() const
+    // time manager limits, -1 when the search isn't timed
+    constexpr std::time_t get_soft_limit() const
+    {
+        return timeset ? soft_limit : -1;
+    }
+    constexpr std::time_t get_hard_limit() const
+    {
+        return timeset ? hard_limit : -1;
+    }
+
+    // time used by the search, measured in nodes when nodes time is enabled
+    const std::time_t get_search_time(int64_t nodes) const
+    {
+        return nodes_time ? nodes / nodes_time : get_time_elapsed();
+    }
+
+    const bool soft_limit_passed(int64_t nodes) const
     {
-        return timeset && soft_limit != -1 && get_time_elapsed() >= recommended_soft_limit;
+        return timeset && soft_limit != -1 && get_search_time(nodes) >= recommended_soft_limit;
     }
-    const bool hard_limit_passed() const
+    const bool hard_limit_passed(int64_t nodes) const
     {
-        return timeset && get_time_elapsed() >= hard_limit;
+        return timeset && get_search_time(nodes) >= hard_limit;
     }
     constexpr bool min_nodes_passed(int64_t nodes) const
     {
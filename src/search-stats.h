@@ -0,0 +1,57 @@
+/*
+  Clover is a UCI chess playing engine authored by Luca Metehau.
+  <https://github.com/lucametehau/CloverEngine>
+
+  Clover is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Clover is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "defs.h"
+#include <array>
+#include <string>
+
+// search statistics, only gathered when compiling with -DSEARCH_STATS
+// every statistic is the mean of 0/1 samples, so it's the rate at which something happens
+enum SearchStats : int
+{
+    FIRST_MOVE_CUTOFF = 0, // beta cutoffs produced by the first move
+    TT_CUTOFF,             // non pv nodes with a tt hit returning the tt score
+    RAZORING,              // razoring qsearches confirming the fail low
+    SNMP,                  // non pv nodes pruned by static null move pruning
+    NMP,                   // null move searches failing high
+    PROBCUT,               // probcut attempts producing a cutoff
+    LMP,                   // quiet moves triggering late move pruning
+    FP,                    // quiet moves triggering futility pruning
+    FP_NOISY,              // noisy moves pruned by futility pruning
+    SEE_QUIET,             // quiet moves pruned by see pruning
+    SEE_NOISY,             // noisy moves pruned by see pruning
+    HISTORY_PRUNING,       // quiet moves triggering history pruning
+    LMR_RESEARCH,          // reduced searches needing a full depth research
+    SE_SINGULAR,           // singular searches extending the tt move
+    SE_MULTICUT,           // singular searches producing a multicut
+    SE_NEGATIVE,           // singular searches negatively extending the tt move
+    QS_NODES,              // nodes searched by quiescence search
+    TB_CACHE_HIT,          // successful tablebase probes answered by the WDL cache
+    STATS_COUNT
+};
+
+const std::array<std::string, SearchStats::STATS_COUNT> search_stats_names = {
+    "First move cutoff rate", "TT cutoff rate", "Razoring rate", "SNMP rate", "NMP rate", "Probcut rate", "LMP rate",
+    "FP rate", "Noisy FP rate", "Quiet SEE pruning rate", "Noisy SEE pruning rate", "History pruning rate",
+    "LMR research rate", "SE singular rate", "SE multicut rate", "SE negative extension rate", "QS nodes rate",
+    "TB cache hit rate"};
+
+#ifdef SEARCH_STATS
+#define STATS_UPD(stat, value) stats[SearchStats::stat].upd(value)
+#else
+#define STATS_UPD(stat, value)
+#endif
@@ -17,6 +17,7 @@
 #pragma once
 #include "3rdparty/Fathom/src/tbprobe.h"
 #include "movepick.h"
+#include "tb-cache.h"
 #include "thread.h"
 #include "tt.h"
 #include <algorithm>
@@ -24,16 +25,31 @@
 #include <fstream>
 #include <iomanip>
 
-uint32_t probe_TB(Board &board, int depth)
+uint32_t probe_TB(Board &board, int depth, bool &cached)
 {
-    if (TB_LARGEST && depth >= 2 && !board.half_moves())
+    PROFILE_SCOPE(PROBE_TB);
+    cached = false;
+    // the tablebases don't handle castling rights, which also keeps the key a full description of the position
+    if (depth >= syzygy_probe_depth && !board.half_moves() && !board.has_castling_rights())
     {
-        if (static_cast<uint32_t>((board.get_bb_color(WHITE) | board.get_bb_color(BLACK)).count()) <= TB_LARGEST)
-            return tb_probe_wdl(board.get_bb_color(WHITE), board.get_bb_color(BLACK),
-                                board.get_bb_piece_type(PieceTypes::KING), board.get_bb_piece_type(PieceTypes::QUEEN),
-                                board.get_bb_piece_type(PieceTypes::ROOK), board.get_bb_piece_type(PieceTypes::BISHOP),
-                                board.get_bb_piece_type(PieceTypes::KNIGHT), board.get_bb_piece_type(PieceTypes::PAWN),
-                                0, 0, board.enpas() == NO_SQUARE ? static_cast<Square>(0) : board.enpas(), board.turn);
+        if (static_cast<uint32_t>((board.get_bb_color(WHITE) | board.get_bb_color(BLACK)).count()) <= tb_probe_limit())
+        {
+            uint32_t result;
+            if (tb_cache.probe(board.key(), result))
+            {
+                cached = true;
+                return result;
+            }
+            result =
+                tb_probe_wdl(board.get_bb_color(WHITE), board.get_bb_color(BLACK),
+                             board.get_bb_piece_type(PieceTypes::KING), board.get_bb_piece_type(PieceTypes::QUEEN),
+                             board.get_bb_piece_type(PieceTypes::ROOK), board.get_bb_piece_type(PieceTypes::BISHOP),
+                             board.get_bb_piece_type(PieceTypes::KNIGHT), board.get_bb_piece_type(PieceTypes::PAWN), 0,
+                             0, board.enpas() == NO_SQUARE ? static_cast<Square>(0) : board.enpas(), board.turn);
+            if (result != TB_RESULT_FAILED)
+                tb_cache.save(board.key(), result);
+            return result;
+        }
     }
     return TB_RESULT_FAILED;
 }
@@ -42,15 +58,16 @@ template <bool pvNode> int SearchThread::quiesce(int alpha, int beta, StackEntry
 {
     const int ply = board.ply;
     if (ply >= MAX_DEPTH)
-        return evaluate(board, NN);
+        return evaluate(board, *NN);
 
     pv_table_len[ply] = 0;
     nodes.fetch_add(1, std::memory_order_relaxed);
+    STATS_UPD(QS_NODES, 1);
     if (board.is_draw(ply))
         return draw_score();
 
     if (check_for_stop<false>())
-        return evaluate(board, NN);
+        return evaluate(board, *NN);
 
     const Key key = board.key();
     const bool turn = board.turn;
@@ -59,7 +76,8 @@ template <bool pvNode> int SearchThread::quiesce(int alpha, int beta, StackEntry
     Move best_move = NULLMOVE, tt_move = NULLMOVE;
 
     bool tt_hit = false;
-    Entry *entry = TT->probe(key, tt_hit);
+    Entry tt_copy;
+    Entry *entry = probe_tt(key, tt_hit, tt_copy);
 
     int eval = INF, tt_value = INF, raw_eval{};
     bool was_pv = pvNode;
@@ -90,17 +108,17 @@ template <bool pvNode> int SearchThread::quiesce(int alpha, int beta, StackEntry
     }
     else if (!tt_hit)
     {
-        raw_eval = evaluate(board, NN);
-        stack->eval = best = eval = histories.get_corrected_eval(raw_eval, turn, board.pawn_key(), board.mat_key(WHITE),
-                                                                 board.mat_key(BLACK), stack);
+        raw_eval = evaluate(board, *NN);
+        stack->eval = best = eval = histories->get_corrected_eval(raw_eval, turn, board.pawn_key(),
+                                                                  board.mat_key(WHITE), board.mat_key(BLACK), stack);
         futility_base = best + QuiesceFutilityBias;
     }
     else
     {
         // tt_value might be a better evaluation
         raw_eval = eval;
-        stack->eval = eval = histories.get_corrected_eval(raw_eval, turn, board.pawn_key(), board.mat_key(WHITE),
-                                                          board.mat_key(BLACK), stack);
+        stack->eval = eval = histories->get_corrected_eval(raw_eval, turn, board.pawn_key(), board.mat_key(WHITE),
+                                                           board.mat_key(BLACK), stack);
         if (tt_bound == TTBounds::EXACT || (tt_bound == TTBounds::LOWER && tt_value > eval) ||
             (tt_bound == TTBounds::UPPER && tt_value < eval))
             best = tt_value;
@@ -113,7 +131,7 @@ template <bool pvNode> int SearchThread::quiesce(int alpha, int beta, StackEntry
         if (abs(best) < MATE && abs(beta) < MATE)
             best = (best + beta) / 2;
         if (!tt_hit)
-            TT->save(entry, key, best, 0, ply, TTBounds::LOWER, NULLMOVE, raw_eval, was_pv);
+            save_tt(entry, key, best, 0, ply, TTBounds::LOWER, NULLMOVE, raw_eval, was_pv);
         return best;
     }
 
@@ -123,14 +141,15 @@ template <bool pvNode> int SearchThread::quiesce(int alpha, int beta, StackEntry
 
     alpha = std::max(alpha, best);
 
-    Movepick qs_movepicker(!in_check && tt_move && see(board, tt_move, 0) ? tt_move : NULLMOVE, board.threats(),
-                           in_check);
+    SEEContext see_context(board);
+    Movepick qs_movepicker(!in_check && tt_move && see_context.see(tt_move, 0) ? tt_move : NULLMOVE,
+                           board.threats(), in_check);
     Move move;
     int played = 0;
 
-    while ((move = qs_movepicker.get_next_move(histories, stack, board)))
+    while ((move = qs_movepicker.get_next_move(*histories, stack, board)))
     {
-        if (qs_movepicker.stage == Stages::STAGE_QS_NOISY && !see(board, move, QuiesceSEEMargin))
+        if (qs_movepicker.stage == Stages::STAGE_QS_NOISY && !see_context.see(move, QuiesceSEEMargin))
         {
             continue;
         }
@@ -160,8 +179,8 @@ template <bool pvNode> int SearchThread::quiesce(int alpha, int beta, StackEntry
         TT->prefetch(board.speculative_next_key(move));
         stack->move = move;
         stack->piece = board.piece_at(move.get_from());
-        stack->cont_hist = &histories.cont_history[!board.is_noisy_move(move)][stack->piece][move.get_to()];
-        stack->cont_corr_hist = &histories.cont_corr_hist[stack->piece][move.get_to()];
+        stack->cont_hist = &histories->cont_history[!board.is_noisy_move(move)][stack->piece][move.get_to()];
+        stack->cont_corr_hist = &histories->cont_corr_hist[stack->piece][move.get_to()];
 
         make_move(move, next_state);
 
@@ -198,7 +217,7 @@ template <bool pvNode> int SearchThread::quiesce(int alpha, int beta, StackEntry
 
     // store info in transposition table
     tt_bound = best >= beta ? TTBounds::LOWER : TTBounds::UPPER;
-    TT->save(entry, key, best, 0, ply, tt_bound, best_move, raw_eval, was_pv);
+    save_tt(entry, key, best, 0, ply, tt_bound, best_move, raw_eval, was_pv);
 
     return best;
 }
@@ -209,7 +228,7 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
     const int ply = board.ply;
 
     if (check_for_stop<true>() || ply >= MAX_DEPTH)
-        return evaluate(board, NN);
+        return evaluate(board, *NN);
 
     if (depth <= 0)
         return quiesce<pvNode>(alpha, beta, stack);
@@ -235,7 +254,9 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
     bool tt_hit = false;
 
     nodes.fetch_add(1, std::memory_order_relaxed);
-    sel_depth = std::max(sel_depth, ply);
+    STATS_UPD(QS_NODES, 0);
+    if (ply > sel_depth.load(std::memory_order_relaxed))
+        sel_depth.store(ply, std::memory_order_relaxed);
     (stack - 1)->R = 0; // reset to not have to reset in LMR
 
     pv_table_len[ply] = 0;
@@ -254,7 +275,8 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
             return alpha;
     }
 
-    Entry *entry = TT->probe(key, tt_hit);
+    Entry tt_copy;
+    Entry *entry = probe_tt(key, tt_hit, tt_copy);
 
     /// transposition table probing
     int eval = INF;
@@ -271,8 +293,10 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
         was_pv |= entry->was_pv();
         if constexpr (!pvNode)
         {
-            if (score != VALUE_NONE && tt_depth >= depth &&
-                (tt_bound & (score >= beta ? TTBounds::LOWER : TTBounds::UPPER)))
+            const bool tt_cutoff = score != VALUE_NONE && tt_depth >= depth &&
+                                   (tt_bound & (score >= beta ? TTBounds::LOWER : TTBounds::UPPER));
+            STATS_UPD(TT_CUTOFF, tt_cutoff);
+            if (tt_cutoff)
                 return score;
         }
     }
@@ -280,10 +304,12 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
     // tablebase probing
     if constexpr (!rootNode)
     {
-        const auto probe = probe_TB(board, depth);
+        bool cached;
+        const auto probe = probe_TB(board, depth, cached);
         if (probe != TB_RESULT_FAILED)
         {
             tb_hits.fetch_add(1, std::memory_order_relaxed);
+            STATS_UPD(TB_CACHE_HIT, cached);
 
             const auto [score, tt_bound] = [probe, ply]() -> std::pair<int, int> {
                 if (probe == TB_WIN)
@@ -295,7 +321,7 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
 
             if (tt_bound & (score >= beta ? TTBounds::LOWER : TTBounds::UPPER))
             {
-                TT->save(entry, key, score, MAX_DEPTH, 0, tt_bound, NULLMOVE, 0, was_pv);
+                save_tt(entry, key, score, MAX_DEPTH, 0, tt_bound, NULLMOVE, 0, was_pv);
                 return score;
             }
         }
@@ -318,20 +344,20 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
             raw_eval = eval = stack->eval;
         else
         {
-            raw_eval = evaluate(board, NN);
+            raw_eval = evaluate(board, *NN);
             stack->eval = eval =
-                histories.get_corrected_eval(raw_eval, turn, pawn_key, white_mat_key, black_mat_key, stack);
-            TT->save(entry, key, VALUE_NONE, 0, ply, 0, NULLMOVE, raw_eval, was_pv);
+                histories->get_corrected_eval(raw_eval, turn, pawn_key, white_mat_key, black_mat_key, stack);
+            save_tt(entry, key, VALUE_NONE, 0, ply, 0, NULLMOVE, raw_eval, was_pv);
         }
     }
     else
     {
         if (stack->excluded)
-            raw_eval = evaluate(board, NN);
+            raw_eval = evaluate(board, *NN);
         else
             raw_eval = eval;
         stack->eval = eval =
-            histories.get_corrected_eval(raw_eval, turn, pawn_key, white_mat_key, black_mat_key, stack);
+            histories->get_corrected_eval(raw_eval, turn, pawn_key, white_mat_key, black_mat_key, stack);
         // tt_value might be a better evaluation
         if (tt_bound == TTBounds::EXACT || (tt_bound == TTBounds::LOWER && tt_value > eval) ||
             (tt_bound == TTBounds::UPPER && tt_value < eval))
@@ -382,14 +408,17 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
     {
         int bonus = std::clamp<int>(-EvalHistCoef * ((stack - 1)->eval + static_eval), EvalHistMin, EvalHistMax) +
                     EvalHistMargin;
-        histories.update_main_hist_move((stack - 1)->move, (stack - 1)->threats, 1 ^ turn, bonus);
-        histories.update_pawn_hist_move((stack - 1)->piece, (stack - 1)->move.get_to(), board.state->prev->pawn_key,
-                                        bonus);
+        histories->update_main_hist_move((stack - 1)->move, (stack - 1)->threats, 1 ^ turn, bonus);
+        histories->update_pawn_hist_move((stack - 1)->piece, (stack - 1)->move.get_to(), board.state->prev->pawn_key,
+                                         bonus);
     }
 
     if (previous_R >= 3 && !improving_after_move && !in_check && (stack - 1)->eval != INF)
         depth += 1 + bad_static_eval;
 
+    // attack maps for SEE, shared by probcut, the move picker and the pruning of this node
+    SEEContext see_context(board);
+
     if constexpr (!pvNode)
     {
         if (!in_check)
@@ -399,6 +428,7 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
             if (depth <= RazoringDepth && eval + razoring_margin(depth) <= alpha)
             {
                 int value = quiesce<false>(alpha, alpha + 1, stack);
+                STATS_UPD(RAZORING, value <= alpha);
                 if (value <= alpha)
                     return value;
             }
@@ -410,9 +440,12 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
                        SNMPImprovingAfterMove * improving_after_move - SNMPCutNode * is_cutnode +
                        complexity * SNMPComplexityCoef / 1024 + SNMPBase;
             };
-            if (depth <= SNMPDepth && eval > beta && eval < MATE && (!tt_move || is_tt_move_noisy) &&
+            const bool snmp =
+                depth <= SNMPDepth && eval > beta && eval < MATE && (!tt_move || is_tt_move_noisy) &&
                 eval - snmp_margin(depth - enemy_has_no_threats, improving, improving_after_move, cutNode, complexity) >
-                    beta)
+                    beta;
+            STATS_UPD(SNMP, snmp);
+            if (snmp)
                 return beta > -MATE ? (eval + beta) / 2 : eval;
 
             // null move pruning (when last move wasn't null, we still have non pawn material, we have a good position)
@@ -424,13 +457,14 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
 
                 stack->move = NULLMOVE;
                 stack->piece = NO_PIECE;
-                stack->cont_hist = &histories.cont_history[0][PieceTypes::PAWN][Squares::A8];
-                stack->cont_corr_hist = &histories.cont_corr_hist[PieceTypes::PAWN][Squares::A8];
+                stack->cont_hist = &histories->cont_history[0][PieceTypes::PAWN][Squares::A8];
+                stack->cont_corr_hist = &histories->cont_corr_hist[PieceTypes::PAWN][Squares::A8];
 
                 board.make_null_move(next_state);
                 int score = -search<false, false, !cutNode>(-beta, -beta + 1, depth - R, stack + 1);
                 board.undo_null_move();
 
+                STATS_UPD(NMP, score >= beta);
                 if (score >= beta)
                     return abs(score) > MATE ? beta : score; /// don't trust mate scores
                 else if (previous_R && abs(score) < MATE && score < beta - NMPHindsightMargin)
@@ -443,21 +477,21 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
                 !(tt_hit && tt_depth >= depth - 3 && tt_value < probcut_beta))
             {
                 Movepick picker(tt_move && board.is_noisy_move(tt_move) &&
-                                        see(board, tt_move, probcut_beta - static_eval)
+                                        see_context.see(tt_move, probcut_beta - static_eval)
                                     ? tt_move
                                     : NULLMOVE,
-                                probcut_beta - static_eval, board.threats());
+                                probcut_beta - static_eval, board.threats(), see_context);
 
                 Move move;
-                while ((move = picker.get_next_move(histories, stack, board)) != NULLMOVE)
+                while ((move = picker.get_next_move(*histories, stack, board)) != NULLMOVE)
                 {
                     if (move == stack->excluded)
                         continue;
 
                     stack->move = move;
                     stack->piece = board.piece_at(move.get_from());
-                    stack->cont_hist = &histories.cont_history[0][stack->piece][move.get_to()];
-                    stack->cont_corr_hist = &histories.cont_corr_hist[stack->piece][move.get_to()];
+                    stack->cont_hist = &histories->cont_history[0][stack->piece][move.get_to()];
+                    stack->cont_corr_hist = &histories->cont_corr_hist[stack->piece][move.get_to()];
 
                     make_move(move, next_state);
 
@@ -471,24 +505,39 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
                     if (score >= probcut_beta)
                     {
                         if (!stack->excluded)
-                            TT->save(entry, key, score, depth - 3, ply, TTBounds::LOWER, move, raw_eval, was_pv);
+                            save_tt(entry, key, score, depth - 3, ply, TTBounds::LOWER, move, raw_eval, was_pv);
+                        STATS_UPD(PROBCUT, 1);
                         return score;
                     }
                 }
+                STATS_UPD(PROBCUT, 0);
             }
         }
     }
 
     Movepick picker(tt_move, stack->killer, kp_move[turn][board.king_pawn_key() & KP_MOVE_MASK],
-                    -(rootNode ? RootSeeDepthCoef : PVSSeeDepthCoef) * depth, board.threats());
+                    -(rootNode ? RootSeeDepthCoef : PVSSeeDepthCoef) * depth, board.threats(), see_context);
 
     Move move;
 
-    while ((move = picker.get_next_move(histories, stack, board)) != NULLMOVE)
+    // moves postponed because another thread is searching them (ABDADA), searched after all the other moves
+    auto &deferred = deferred_moves[ply];
+    std::size_t nr_deferred = 0, deferred_idx = 0;
+    const auto next_move = [&]() {
+        if (deferred_idx == 0)
+        {
+            const Move move = picker.get_next_move(*histories, stack, board);
+            if (move != NULLMOVE)
+                return move;
+        }
+        return deferred_idx < nr_deferred ? deferred[deferred_idx++].move : NULLMOVE;
+    };
+
+    while ((move = next_move()) != NULLMOVE)
     {
         if constexpr (rootNode)
         {
-            if (root_moves.move_was_searched(move))
+            if (!root_moves.has_move(move) || root_moves.move_was_searched(move))
                 continue;
         }
         if (move == stack->excluded)
@@ -498,6 +547,8 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
         const Square from = move.get_from(), to = move.get_to();
         const Piece piece = board.piece_at(from);
         int history = 0;
+        // deferred moves are pruned and reduced as if searched in their original place
+        const int move_index = deferred_idx ? deferred[deferred_idx - 1].index : played;
 
 #ifdef GENERATE
         if constexpr (!pvNode)
@@ -511,59 +562,88 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
                 if (is_quiet)
                 {
                     history =
-                        histories.get_history_search(move, piece, board.threats().all_threats, turn, stack, pawn_key);
+                        histories->get_history_search(move, piece, board.threats().all_threats, turn, stack, pawn_key);
 
                     // approximately the new depth for the next search
-                    int new_depth = std::max(0, depth - lmr_red[std::min(63, depth)][std::min(63, played)] / LMRGrain +
-                                                    improving + history / MoveloopHistDiv);
+                    int new_depth =
+                        std::max(0, depth - lmr_red[std::min(63, depth)][std::min(63, move_index)] / LMRGrain +
+                                        improving + history / MoveloopHistDiv);
 
                     // futility pruning
                     auto futility_margin = [&](int depth) { return FPBias + FPMargin * depth; };
-                    if (new_depth <= FPDepth && !in_check && static_eval + futility_margin(new_depth) <= alpha)
+                    const bool futility =
+                        new_depth <= FPDepth && !in_check && static_eval + futility_margin(new_depth) <= alpha;
+                    STATS_UPD(FP, futility);
+                    if (futility)
                         picker.skip_quiets();
 
                     // late move pruning
-                    if (new_depth <= LMPDepth && played >= (LMPBias + new_depth * new_depth) / (2 - improving))
+                    const bool lmp =
+                        new_depth <= LMPDepth && move_index >= (LMPBias + new_depth * new_depth) / (2 - improving);
+                    STATS_UPD(LMP, lmp);
+                    if (lmp)
                         picker.skip_quiets();
 
                     // history pruning
                     auto history_margin = [&](int depth) { return -HistoryPruningMargin * depth; };
-                    if (depth <= HistoryPruningDepth && bad_static_eval && history < history_margin(depth))
+                    const bool history_pruning =
+                        depth <= HistoryPruningDepth && bad_static_eval && history < history_margin(depth);
+                    STATS_UPD(HISTORY_PRUNING, history_pruning);
+                    if (history_pruning)
                     {
                         picker.skip_quiets();
                         continue;
                     }
 
                     // see pruning for quiet moves
-                    if (new_depth <= SEEPruningQuietDepth && !in_check &&
-                        !see(board, move, -SEEPruningQuietMargin * new_depth - history / SEEQuietHistDiv))
+                    const bool see_pruning =
+                        new_depth <= SEEPruningQuietDepth && !in_check &&
+                        !see_context.see(move, -SEEPruningQuietMargin * new_depth - history / SEEQuietHistDiv);
+                    STATS_UPD(SEE_QUIET, see_pruning);
+                    if (see_pruning)
                         continue;
                 }
                 else
                 {
                     history =
-                        histories.get_cap_hist(piece, to, board.get_captured_type(move), board.threats().all_threats);
+                        histories->get_cap_hist(piece, to, board.get_captured_type(move), board.threats().all_threats);
                     // see pruning for noisy moves
                     auto noisy_see_pruning_margin = [&](int depth, int history) {
                         return -SEEPruningNoisyMargin * depth * depth - history / SEENoisyHistDiv;
                     };
-                    if (depth <= SEEPruningNoisyDepth && !in_check && picker.trueStage > Stages::STAGE_GOOD_NOISY &&
-                        !see(board, move, noisy_see_pruning_margin(depth + bad_static_eval, history)))
+                    const bool see_pruning =
+                        depth <= SEEPruningNoisyDepth && !in_check && picker.trueStage > Stages::STAGE_GOOD_NOISY &&
+                        !see_context.see(move, noisy_see_pruning_margin(depth + bad_static_eval, history));
+                    STATS_UPD(SEE_NOISY, see_pruning);
+                    if (see_pruning)
                         continue;
 
                     // futility pruning for noisy moves
                     auto noisy_futility_margin = [&](int depth, Piece captured, int history) {
                         return FPNoisyBias + seeVal[captured] + FPNoisyMargin * depth + history / FPNoisyHistoryDiv;
                     };
-                    if (depth <= FPNoisyDepth && !in_check &&
+                    const bool futility =
+                        depth <= FPNoisyDepth && !in_check &&
                         static_eval + noisy_futility_margin(depth + is_tt_move_noisy, board.get_captured_type(move),
                                                             history) <=
-                            alpha)
+                            alpha;
+                    STATS_UPD(FP_NOISY, futility);
+                    if (futility)
                         continue;
                 }
             }
         }
 
+        // ABDADA: defer the move if the resulting position is already being searched by another thread
+        const Key abdada_key =
+            !rootNode && info.is_abdada() && depth >= ABDADA_DEFER_DEPTH ? board.speculative_next_key(move) : 0;
+        if (abdada_key && played && !deferred_idx && nr_deferred < deferred.size() &&
+            abdada_table.is_searching(abdada_key))
+        {
+            deferred[nr_deferred++] = {move, played};
+            continue;
+        }
+
         int ex = 0;
         // avoid extending too far (might cause stack overflow)
         if (ply < 2 * id_depth && !rootNode)
@@ -578,6 +658,10 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
                 int score = search<false, false, cutNode>(rBeta - 1, rBeta, (depth - 1) / 2, stack);
                 stack->excluded = NULLMOVE;
 
+                STATS_UPD(SE_SINGULAR, score < rBeta);
+                STATS_UPD(SE_MULTICUT, score >= rBeta && rBeta >= beta);
+                STATS_UPD(SE_NEGATIVE, score >= rBeta && rBeta < beta && (tt_value >= beta || cutNode));
+
                 if (score < rBeta)
                 {
                     ex = 1 + (!pvNode && rBeta - score > SEDoubleExtensionsMargin) +
@@ -602,9 +686,11 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
         TT->prefetch(board.speculative_next_key(move));
         stack->move = move;
         stack->piece = piece;
-        stack->cont_hist = &histories.cont_history[is_quiet][piece][to];
-        stack->cont_corr_hist = &histories.cont_corr_hist[piece][to];
+        stack->cont_hist = &histories->cont_history[is_quiet][piece][to];
+        stack->cont_corr_hist = &histories->cont_corr_hist[piece][to];
 
+        if (abdada_key)
+            abdada_table.start_search(abdada_key);
         make_move(move, next_state);
         played++;
 
@@ -624,9 +710,9 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
         int score = -INF, tried_count = 0;
 
         // late move reductions
-        if (depth >= 2 && played > 1 + pvNode + rootNode)
+        if (depth >= 2 && move_index > pvNode + rootNode)
         {
-            R = lmr_red[std::min(63, depth)][std::min(63, played)];
+            R = lmr_red[std::min(63, depth)][std::min(63, move_index + 1)];
 
             R -= LMRGrain * history /
                  (is_quiet ? HistReductionDiv : CapHistReductionDiv); // reduce move based on history
@@ -663,6 +749,7 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
             stack->R = 0;
             tried_count++;
 
+            STATS_UPD(LMR_RESEARCH, R > 1 && score > alpha);
             if (R > 1 && score > alpha)
             {
                 new_depth += (score > best + DeeperMargin) - (score < best + new_depth);
@@ -687,6 +774,8 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
         }
 
         undo_move(move);
+        if (abdada_key)
+            abdada_table.finish_search(abdada_key);
 
         [[unlikely]] if (must_stop()) // stop search
             return best;
@@ -701,7 +790,7 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
             if (played == 1 || score > alpha)
             {
                 root_move.score = score;
-                root_move.sel_depth = sel_depth;
+                root_move.sel_depth = sel_depth.load(std::memory_order_relaxed);
 
                 root_move.lowerbound = score >= beta;
                 root_move.upperbound = score <= alpha;
@@ -729,6 +818,7 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
 
                 if (alpha >= beta)
                 {
+                    STATS_UPD(FIRST_MOVE_CUTOFF, played == 1);
                     stack->cutoff_cnt++;
                     const int bonus_depth = depth + bad_static_eval + (cutNode && depth <= 3);
                     const int malus_depth = depth + bad_static_eval + (cutNode && depth <= 3) + allNode;
@@ -742,12 +832,12 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
                         {
                             const Piece piece = board.piece_at(best_move.get_from());
                             const Square to = best_move.get_to();
-                            histories.update_main_hist_move(best_move, board.threats().all_threats, turn,
-                                                            MainHistory::bonus(bonus_depth) * tried_count);
-                            histories.update_cont_hist_move(piece, to, stack,
-                                                            ContinuationHistory::bonus(bonus_depth) * tried_count);
-                            histories.update_pawn_hist_move(piece, to, pawn_key,
-                                                            PawnHistory::bonus(bonus_depth) * tried_count);
+                            histories->update_main_hist_move(best_move, board.threats().all_threats, turn,
+                                                             MainHistory::bonus(bonus_depth) * tried_count);
+                            histories->update_cont_hist_move(piece, to, stack,
+                                                             ContinuationHistory::bonus(bonus_depth) * tried_count);
+                            histories->update_pawn_hist_move(piece, to, pawn_key,
+                                                             PawnHistory::bonus(bonus_depth) * tried_count);
                         }
 
                         for (std::size_t i = 0; i < nr_quiets; i++)
@@ -755,26 +845,26 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
                             const auto [move, tried_count] = quiets[i];
                             const Piece piece = board.piece_at(move.get_from());
                             const Square to = move.get_to();
-                            histories.update_main_hist_move(move, board.threats().all_threats, turn,
-                                                            MainHistory::malus(malus_depth) * tried_count);
-                            histories.update_cont_hist_move(piece, to, stack,
-                                                            ContinuationHistory::malus(malus_depth) * tried_count);
-                            histories.update_pawn_hist_move(piece, to, pawn_key,
-                                                            PawnHistory::malus(malus_depth) * tried_count);
+                            histories->update_main_hist_move(move, board.threats().all_threats, turn,
+                                                             MainHistory::malus(malus_depth) * tried_count);
+                            histories->update_cont_hist_move(piece, to, stack,
+                                                             ContinuationHistory::malus(malus_depth) * tried_count);
+                            histories->update_pawn_hist_move(piece, to, pawn_key,
+                                                             PawnHistory::malus(malus_depth) * tried_count);
                         }
                     }
                     else
                     {
-                        histories.update_cap_hist_move(board.piece_at(best_move.get_from()), best_move.get_to(),
-                                                       board.get_captured_type(best_move), board.threats().all_threats,
-                                                       CaptureHistory::bonus(bonus_depth) * tried_count);
+                        histories->update_cap_hist_move(board.piece_at(best_move.get_from()), best_move.get_to(),
+                                                        board.get_captured_type(best_move), board.threats().all_threats,
+                                                        CaptureHistory::bonus(bonus_depth) * tried_count);
                     }
                     for (std::size_t i = 0; i < nr_noisies; i++)
                     {
                         const auto [move, tried_count] = noisies[i];
-                        histories.update_cap_hist_move(board.piece_at(move.get_from()), move.get_to(),
-                                                       board.get_captured_type(move), board.threats().all_threats,
-                                                       CaptureHistory::malus(malus_depth) * tried_count);
+                        histories->update_cap_hist_move(board.piece_at(move.get_from()), move.get_to(),
+                                                        board.get_captured_type(move), board.threats().all_threats,
+                                                        CaptureHistory::malus(malus_depth) * tried_count);
                     }
                     break;
                 }
@@ -795,10 +885,10 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
 
     if (!best_move && board.captured() == NO_PIECE && !null_search)
     {
-        histories.update_cont_hist_move((stack - 1)->piece, (stack - 1)->move.get_to(), stack - 1,
-                                        ContinuationHistory::bonus(depth) * FailLowContHistCoef / 128);
-        histories.update_main_hist_move((stack - 1)->move, (stack - 1)->threats, 1 ^ turn,
-                                        MainHistory::bonus(depth) * FailLowHistCoef / 128);
+        histories->update_cont_hist_move((stack - 1)->piece, (stack - 1)->move.get_to(), stack - 1,
+                                         ContinuationHistory::bonus(depth) * FailLowContHistCoef / 128);
+        histories->update_main_hist_move((stack - 1)->move, (stack - 1)->threats, 1 ^ turn,
+                                         MainHistory::bonus(depth) * FailLowHistCoef / 128);
     }
 
     // update tt only if we aren't in a singular search
@@ -808,8 +898,8 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
         if ((tt_bound == TTBounds::UPPER || !board.is_noisy_move(best_move)) && !in_check &&
             !(tt_bound == TTBounds::LOWER && best <= static_eval) &&
             !(tt_bound == TTBounds::UPPER && best >= static_eval))
-            histories.update_corr_hist(turn, pawn_key, white_mat_key, black_mat_key, stack, depth, best - static_eval);
-        TT->save(entry, key, best, depth, ply, tt_bound, best_move, raw_eval, was_pv);
+            histories->update_corr_hist(turn, pawn_key, white_mat_key, black_mat_key, stack, depth, best - static_eval);
+        save_tt(entry, key, best, depth, ply, tt_bound, best_move, raw_eval, was_pv);
     }
 
     return best;
@@ -817,30 +907,47 @@ int SearchThread::search(int alpha, int beta, int depth, StackEntry *stack)
 
 void SearchThread::print_iteration_info(uint64_t t, int depth, uint64_t total_nodes, uint64_t total_tb_hits)
 {
-    for (int multipv = 0; multipv < info.get_multipv(); multipv++)
+    RootMoves lines = root_moves;
+    int nr_lines = multipv_lines;
+#ifndef GENERATE
+    if (info.get_multipv_groups() > 1)
+    {
+        // lines are searched by different threads, print the merged result
+        int merged_depth;
+        RootMoves merged = thread_pool->gather_root_moves(merged_depth);
+        if (!merged.empty())
+        {
+            lines = merged;
+            depth = merged_depth;
+            nr_lines = std::min(info.get_multipv(), merged.size());
+        }
+    }
+#endif
+
+    for (int multipv = 0; multipv < nr_lines; multipv++)
     {
         std::cout << "info multipv " << multipv + 1 << " score ";
 
-        if (root_moves[multipv].score > MATE)
-            std::cout << "mate " << (INF - root_moves[multipv].score + 1) / 2;
-        else if (root_moves[multipv].score < -MATE)
-            std::cout << "mate -" << (INF + root_moves[multipv].score + 1) / 2;
+        if (lines[multipv].score > MATE)
+            std::cout << "mate " << (INF - lines[multipv].score + 1) / 2;
+        else if (lines[multipv].score < -MATE)
+            std::cout << "mate -" << (INF + lines[multipv].score + 1) / 2;
 
         else
-            std::cout << "cp " << root_moves[multipv].score;
-        if (root_moves[multipv].lowerbound)
+            std::cout << "cp " << lines[multipv].score;
+        if (lines[multipv].lowerbound)
             std::cout << " lowerbound";
-        else if (root_moves[multipv].upperbound)
+        else if (lines[multipv].upperbound)
             std::cout << " upperbound";
 
-        std::cout << " depth " << depth << " seldepth " << root_moves[multipv].sel_depth << " nodes " << total_nodes;
+        std::cout << " depth " << depth << " seldepth " << lines[multipv].sel_depth << " nodes " << total_nodes;
         if (t)
             std::cout << " nps " << total_nodes * 1000 / t;
         std::cout << " time " << t << " ";
         std::cout << "tbhits " << total_tb_hits << " hashfull " << TT->hashfull() << " ";
         std::cout << "pv ";
-        for (int i = 0; i < root_moves[multipv].pv_len; i++)
-            std::cout << root_moves[multipv].pv[i].to_string(info.is_chess960()) << " ";
+        for (int i = 0; i < lines[multipv].pv_len; i++)
+            std::cout << lines[multipv].pv[i].to_string(info.is_chess960()) << " ";
         std::cout << std::endl;
     }
 }
@@ -863,13 +970,13 @@ void SearchThread::start_search()
 #ifndef GENERATE
     memcpy(&board, &thread_pool->board, sizeof(Board));
 #endif
-    NN.init(board);
+    NN->init(board);
     clear_stack();
-    nodes = sel_depth = tb_hits = 0;
-    time_check_count = 0;
+    nodes = sel_depth = reported_depth = tb_hits = 0;
+    time_check_count = epoch_nodes = 0;
     best_move_cnt = 0;
     completed_depth = 0;
-    root_eval = !board.checkers() ? evaluate(board, NN) : INF;
+    root_eval = !board.checkers() ? evaluate(board, *NN) : INF;
 
     search_stack.fill(StackEntry());
     stack = search_stack.data() + 10;
@@ -880,12 +987,19 @@ void SearchThread::start_search()
 
     for (int i = 1; i <= 10; i++)
     {
-        (stack - i)->cont_hist = &histories.cont_history[0][PieceTypes::PAWN][Squares::A8];
-        (stack - i)->cont_corr_hist = &histories.cont_corr_hist[PieceTypes::PAWN][Squares::A8];
+        (stack - i)->cont_hist = &histories->cont_history[0][PieceTypes::PAWN][Squares::A8];
+        (stack - i)->cont_corr_hist = &histories->cont_corr_hist[PieceTypes::PAWN][Squares::A8];
         (stack - i)->eval = INF;
         (stack - i)->move = NULLMOVE;
     }
+#ifndef GENERATE
+    {
+        EpochExit epoch_exit{this};
+        iterative_deepening();
+    }
+#else
     iterative_deepening();
+#endif
 
     if (!main_thread())
         return;
@@ -907,14 +1021,22 @@ void SearchThread::iterative_deepening()
 
     MoveList moves;
     int nr_moves = board.gen_legal_moves<MOVEGEN_ALL>(moves);
+#ifndef GENERATE
+    nr_moves = thread_pool->filter_root_moves(moves, nr_moves);
+#endif
 
-    root_moves = RootMoves(moves, nr_moves);
+    root_moves = RootMoves(moves, nr_moves, info.get_multipv_groups(), thread_id % info.get_multipv_groups());
+    multipv_lines = std::min(info.get_multipv(), root_moves.size());
 
     for (id_depth = 1; id_depth <= limitDepth; id_depth++)
     {
-        for (int i = 0; i < nr_moves; i++)
+        if (skip_iteration(id_depth))
+            continue;
+        reported_depth.store(id_depth, std::memory_order_relaxed);
+
+        for (int i = 0; i < root_moves.size(); i++)
             root_moves[i].searched = false;
-        for (multipv = 0; multipv < info.get_multipv(); multipv++)
+        for (multipv = 0; multipv < multipv_lines; multipv++)
         {
             int window = AspirationWindowsValue * (1 + (thread_id % 4 == 3)) +
                          root_moves[0].search_score * root_moves[0].search_score / AspirationWindowsDivisor;
@@ -933,7 +1055,7 @@ void SearchThread::iterative_deepening()
             while (true)
             {
                 depth = std::max(depth, 1);
-                sel_depth = 0;
+                sel_depth.store(0, std::memory_order_relaxed);
                 int score = search<true, true, false>(alpha, beta, depth, stack);
 
                 root_moves.sort();
@@ -975,7 +1097,10 @@ void SearchThread::iterative_deepening()
             for (int i = 0; i <= multipv; i++)
                 root_moves[i].searched = true;
 
-            if (main_thread() && printStats && (multipv == info.get_multipv() - 1 || must_stop()))
+            if (info.get_multipv_groups() > 1 && multipv == multipv_lines - 1 && !must_stop())
+                publish_root_moves(id_depth);
+
+            if (main_thread() && printStats && (multipv == multipv_lines - 1 || must_stop()))
             {
                 print_iteration_info(info.get_time_elapsed(), id_depth, thread_pool->get_nodes(),
                                      thread_pool->get_tbhits());
@@ -1014,7 +1139,7 @@ void SearchThread::iterative_deepening()
             break;
         }
 
-        if (main_thread() && (info.soft_limit_passed() || info.min_nodes_passed(nodes)))
+        if (main_thread() && (info.soft_limit_passed(thread_pool->get_nodes()) || info.min_nodes_passed(nodes)))
         {
             state |= STOP;
             break;
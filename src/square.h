@@ -42,22 +42,22 @@ class Square
         return sq - other;
     }
 
-    Square &operator+=(const Square &other)
+    constexpr Square &operator+=(const Square &other)
     {
         sq += other.sq;
         return *this;
     }
-    Square &operator-=(const Square &other)
+    constexpr Square &operator-=(const Square &other)
     {
         sq -= other.sq;
         return *this;
     }
-    Square &operator++()
+    constexpr Square &operator++()
     {
         sq++;
         return *this;
     }
-    Square operator++(int)
+    constexpr Square operator++(int)
     {
         Square temp = *this;
         sq++;
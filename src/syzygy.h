@@ -0,0 +1,179 @@
+/*
+  Clover is a UCI chess playing engine authored by Luca Metehau.
+  <https://github.com/lucametehau/CloverEngine>
+
+  Clover is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Clover is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "3rdparty/Fathom/src/tbprobe.h"
+#include "board.h"
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// set by the SyzygyProbeLimit and SyzygyProbeDepth options
+static int syzygy_probe_limit = 7;
+static int syzygy_probe_depth = 2;
+
+// largest number of pieces for which the tablebases are probed
+inline uint32_t tb_probe_limit()
+{
+    return std::min<uint32_t>(TB_LARGEST, syzygy_probe_limit);
+}
+
+// Asks the OS to read ahead the tables the search of a position is about to probe, on a background thread,
+// so the first probes of a table don't stall on page faults during a time critical move.
+// The WDL tables are probed by the search, the DTZ ones by the root probe at the start of go, for the current
+// material and the material after each capture. Both are read, most urgent first, up to a budget of bytes per position.
+class TBWarmup
+{
+  private:
+    std::thread thread;
+    std::atomic<bool> abort{false};
+
+    // material string of one side, as used in the table names
+    static std::string side_material(const std::array<int, 6> &count)
+    {
+        std::string material = "K";
+        for (Piece pt : {PieceTypes::QUEEN, PieceTypes::ROOK, PieceTypes::BISHOP, PieceTypes::KNIGHT, PieceTypes::PAWN})
+            material += std::string(count[pt], "PNBRQK"[pt]);
+        return material;
+    }
+
+    // the tables of the current material and of the material left after any capture
+    static std::vector<std::string> table_files(const std::string &paths, const Board &board)
+    {
+        std::array<std::array<int, 6>, 2> count{};
+        int pieces = 0;
+        for (auto color : {BLACK, WHITE})
+        {
+            for (Piece pt = PieceTypes::PAWN; pt < PieceTypes::KING; pt++)
+            {
+                count[color][pt] = board.get_bb_piece(pt, color).count();
+                pieces += count[color][pt];
+            }
+        }
+        pieces += 2;
+
+        // the current material first, it is the one probed at the root
+        std::vector<std::string> names;
+        auto add_material = [&](const std::array<std::array<int, 6>, 2> &material) {
+            // the stronger side comes first in the table names, just try both orders
+            for (auto &name : {side_material(material[WHITE]) + "v" + side_material(material[BLACK]),
+                               side_material(material[BLACK]) + "v" + side_material(material[WHITE])})
+            {
+                if (std::find(names.begin(), names.end(), name) == names.end())
+                    names.push_back(name);
+            }
+        };
+        if (pieces <= static_cast<int>(tb_probe_limit()))
+            add_material(count);
+        if (pieces - 1 <= static_cast<int>(tb_probe_limit()))
+        {
+            for (auto color : {BLACK, WHITE})
+            {
+                for (Piece pt = PieceTypes::PAWN; pt < PieceTypes::KING; pt++)
+                {
+                    if (!count[color][pt])
+                        continue;
+                    auto captured = count;
+                    captured[color][pt]--;
+                    add_material(captured);
+                }
+            }
+        }
+
+        // the root is only probed when the position itself is in the tablebases
+        const bool root_probed = pieces <= static_cast<int>(tb_probe_limit()) && !board.has_castling_rights();
+
+        std::vector<std::string> dirs;
+        std::size_t start = 0;
+        while (start <= paths.size())
+        {
+            const std::size_t end = std::min(paths.find(':', start), paths.size());
+            if (end > start)
+                dirs.push_back(paths.substr(start, end - start));
+            start = end + 1;
+        }
+
+        std::vector<std::string> files;
+        for (auto &name : names)
+        {
+            for (auto &dir : dirs)
+            {
+                files.push_back(dir + "/" + name + ".rtbw");
+                if (root_probed)
+                    files.push_back(dir + "/" + name + ".rtbz");
+            }
+        }
+        return files;
+    }
+
+    // reads ahead at most budget bytes of the file, returns the number of bytes requested
+    static uint64_t read_ahead(const std::string &file, uint64_t budget)
+    {
+#ifndef _WIN32
+        const int fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0)
+            return 0;
+        struct stat st;
+        uint64_t size = 0;
+        if (fstat(fd, &st) == 0)
+        {
+            size = std::min<uint64_t>(st.st_size, budget);
+            posix_fadvise(fd, 0, size, POSIX_FADV_WILLNEED);
+        }
+        close(fd);
+        return size;
+#else
+        return 0;
+#endif
+    }
+
+  public:
+    ~TBWarmup()
+    {
+        stop();
+    }
+
+    void start(const std::string &paths, const Board &board, uint64_t budget)
+    {
+        stop();
+        if (!tb_probe_limit() || !budget)
+            return;
+        std::vector<std::string> files = table_files(paths, board);
+        abort = false;
+        thread = std::thread([this, files = std::move(files), budget]() mutable {
+            for (auto &file : files)
+            {
+                if (abort || !budget)
+                    return;
+                budget -= read_ahead(file, budget);
+            }
+        });
+    }
+
+    void stop()
+    {
+        abort = true;
+        if (thread.joinable())
+            thread.join();
+    }
+};
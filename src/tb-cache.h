@@ -0,0 +1,75 @@
+/*
+  Clover is a UCI chess playing engine authored by Luca Metehau.
+  <https://github.com/lucametehau/CloverEngine>
+
+  Clover is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Clover is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "defs.h"
+#include <atomic>
+#include <memory>
+
+// Shared cache of the WDL tablebase results, in front of fathom.
+// Each entry is a single atomic word: the key, with its low bits replaced by the result,
+// so entries can't be torn and no locking is needed.
+class TBCache
+{
+  public:
+    static constexpr uint64_t DEFAULT_SIZE_MB = 16;
+
+  private:
+    static constexpr uint64_t RESULT_MASK = 7;
+    std::unique_ptr<std::atomic<uint64_t>[]> table;
+    uint64_t size = 0;
+
+    std::atomic<uint64_t> &slot(const Key key)
+    {
+        using uint128_t = unsigned __int128;
+        return table[(static_cast<uint128_t>(key) * size) >> 64];
+    }
+
+  public:
+    // allocates the table, 0 bytes frees it
+    void init(uint64_t bytes)
+    {
+        size = bytes / sizeof(uint64_t);
+        table = size ? std::make_unique<std::atomic<uint64_t>[]>(size) : nullptr;
+        clear();
+    }
+
+    void clear()
+    {
+        for (uint64_t i = 0; i < size; i++)
+            table[i].store(0, std::memory_order_relaxed);
+    }
+
+    bool probe(const Key key, uint32_t &result)
+    {
+        if (!size)
+            return false;
+        const uint64_t entry = slot(key).load(std::memory_order_relaxed);
+        if (!entry || (entry ^ key) & ~RESULT_MASK)
+            return false;
+        result = (entry & RESULT_MASK) - 1;
+        return true;
+    }
+
+    // results go from 0 (loss) to 4 (win), stored + 1 so that 0 marks an empty entry
+    void save(const Key key, const uint32_t result)
+    {
+        if (size)
+            slot(key).store((key & ~RESULT_MASK) | (result + 1), std::memory_order_relaxed);
+    }
+};
+
+static TBCache tb_cache;
@@ -0,0 +1,142 @@
+/*
+  Clover is a UCI chess playing engine authored by Luca Metehau.
+  <https://github.com/lucametehau/CloverEngine>
+
+  Clover is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Clover is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "history.h"
+#include "net.h"
+#include "tt.h"
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#ifndef _WIN32
+#include <pthread.h>
+#include <time.h>
+#endif
+
+// periodically writes the state of the running search as JSON lines, to a file or to stderr
+// the thread pool starts it with each search and stops it, writing the final report, before bestmove
+class Telemetry
+{
+  private:
+    std::string path;
+    int interval_ms = 1000;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stop_requested = false;
+
+  public:
+    ~Telemetry()
+    {
+        stop();
+    }
+
+    // an empty path disables telemetry
+    void set_path(const std::string &new_path)
+    {
+        path = new_path == "<empty>" ? "" : new_path;
+    }
+    void set_interval(int interval)
+    {
+        interval_ms = interval;
+    }
+
+    template <typename Pool> void start(Pool &pool)
+    {
+        stop();
+        if (path.empty() || pool.threads.empty())
+            return;
+        stop_requested = false;
+        thread = std::thread([this, &pool] { run(pool); });
+    }
+
+    // wakes the reporting thread, which writes the final report, and waits for it
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop_requested = true;
+        }
+        cv.notify_all();
+        if (thread.joinable())
+            thread.join();
+    }
+
+  private:
+    template <typename Pool> void run(Pool &pool)
+    {
+        std::ofstream file;
+        std::ostream *out = &std::cerr;
+        if (path != "stderr")
+        {
+            file.open(path, std::ios::app);
+            if (!file)
+            {
+                std::cerr << "info string can't open telemetry file " << path << std::endl;
+                return;
+            }
+            out = &file;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        bool stopping = false;
+        while (!stopping)
+        {
+            stopping = cv.wait_for(lock, std::chrono::milliseconds(interval_ms), [&] { return stop_requested; });
+            write_status(*out, pool, !stopping);
+        }
+    }
+
+    // cpu time spent by a thread since its creation, in ms, -1 if unavailable
+    static int64_t cpu_time(std::thread &thread)
+    {
+#ifndef _WIN32
+        clockid_t clock;
+        timespec ts;
+        if (pthread_getcpuclockid(thread.native_handle(), &clock) == 0 && clock_gettime(clock, &ts) == 0)
+            return int64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+#endif
+        return -1;
+    }
+
+    template <typename Pool> static void write_status(std::ostream &out, Pool &pool, bool searching)
+    {
+        const std::time_t elapsed = std::max<std::time_t>(1, pool.info.get_time_elapsed());
+        const uint64_t nodes = pool.get_nodes();
+        const uint64_t threads = pool.threads.size();
+
+        out << "{\"time\":" << elapsed << ",\"searching\":" << (searching ? "true" : "false")
+            << ",\"nodes\":" << nodes << ",\"nps\":" << nodes * 1000 / elapsed << ",\"hashfull\":" << TT->hashfull()
+            << ",\"tbhits\":" << pool.get_tbhits() << ",\"depth\":" << pool.threads.front()->get_depth()
+            << ",\"seldepth\":" << pool.threads.front()->get_sel_depth()
+            << ",\"soft_limit\":" << pool.info.get_soft_limit() << ",\"hard_limit\":" << pool.info.get_hard_limit()
+            << ",\"memory\":{\"tt\":" << TT->buckets * sizeof(Bucket)
+            << ",\"histories\":" << threads * sizeof(Histories) << ",\"accumulators\":" << threads * sizeof(Network)
+            << "},\"threads\":[";
+        for (auto &thread : pool.threads)
+        {
+            const uint64_t thread_nodes = thread->get_nodes();
+            out << (thread->thread_id ? "," : "") << "{\"id\":" << thread->thread_id << ",\"nodes\":" << thread_nodes
+                << ",\"nps\":" << thread_nodes * 1000 / elapsed << ",\"cpu_time\":" << cpu_time(thread->thread)
+                << ",\"depth\":" << thread->get_depth() << ",\"seldepth\":" << thread->get_sel_depth() << "}";
+        }
+        out << "]}" << std::endl;
+    }
+};
@@ -15,6 +15,7 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #pragma once
+#include "abdada.h"
 #include "board.h"
 #include "evaluate.h"
 #include "fen.h"
@@ -22,8 +23,14 @@
 #include "net.h"
 #include "root-moves.h"
 #include "search-info.h"
+#include "search-stats.h"
+#include "syzygy.h"
 #include "tt.h"
+#ifndef GENERATE
+#include "telemetry.h"
+#endif
 #include <atomic>
+#include <barrier>
 #include <chrono>
 #include <condition_variable>
 #include <deque>
@@ -39,9 +46,25 @@ enum ThreadStates : ThreadState
     IDLE = 0,
     SEARCH = 1,
     STOP = 2,
-    EXIT = 4
+    EXIT = 4,
+    CLEAR = 8
+};
+
+// depth skipping schedules for helper threads, reducing the number of threads searching the same iteration
+enum SkipSchedules : int
+{
+    SKIP_NONE = 0,
+    SKIP_BLOCKS = 1,   // threads skip blocks of depths of different sizes and phases
+    SKIP_ALTERNATE = 2 // every other helper skips every other depth
 };
 
+constexpr int SKIP_TABLE_SIZE = 20;
+constexpr std::array<int, SKIP_TABLE_SIZE> skip_size = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+constexpr std::array<int, SKIP_TABLE_SIZE> skip_phase = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+// in deterministic mode, threads synchronise every DETERMINISTIC_EPOCH_NODES nodes
+constexpr int DETERMINISTIC_EPOCH_NODES = 2048;
+
 class ThreadPool;
 
 class alignas(64) SearchThread
@@ -50,7 +73,9 @@ class alignas(64) SearchThread
     Info info;
 
     RootMoves root_moves;
-    std::array<MeanValue, 100> values;
+#ifdef SEARCH_STATS
+    std::array<MeanValue, SearchStats::STATS_COUNT> stats;
+#endif
 
   private:
     std::array<int, MAX_DEPTH + 5> pv_table_len;
@@ -58,13 +83,17 @@ class alignas(64) SearchThread
     MultiArray<Move, 2, KP_MOVE_SIZE> kp_move;
     std::array<StackEntry, MAX_DEPTH + 15> search_stack;
     StackEntry *stack;
+    MultiArray<DeferredMove, MAX_DEPTH + 5, ABDADA_MAX_DEFERRED> deferred_moves;
 
-    Histories histories;
+    std::unique_ptr<Histories> histories;
 
     int time_check_count;
+    int epoch_nodes;
     int best_move_cnt;
-    int multipv;
-    int id_depth, sel_depth;
+    int multipv, multipv_lines;
+    int id_depth;
+    // read by the telemetry thread while searching
+    std::atomic<int> reported_depth{0}, sel_depth{0};
     int root_eval;
 
   public:
@@ -72,7 +101,13 @@ class alignas(64) SearchThread
     std::atomic<int64_t> nodes;
     int completed_depth;
     Board board;
-    Network NN;
+    std::unique_ptr<Network> NN;
+    BucketBuffer<DETERMINISTIC_EPOCH_NODES> tt_buffer;
+
+    // snapshot of the last fully searched iteration, used to merge MultiPV lines searched by different threads
+    std::mutex root_moves_mutex;
+    RootMoves published_root_moves;
+    int published_depth = 0;
 
   public:
     ThreadPool *thread_pool;
@@ -87,13 +122,15 @@ class alignas(64) SearchThread
 #endif
 
   public:
-    SearchThread()
+    SearchThread() : histories(std::make_unique<Histories>()), NN(std::make_unique<Network>())
     {
+        clear_stats();
     }
 
     SearchThread(ThreadPool *thread_pool, int thread_id) : thread_pool(thread_pool), thread_id(thread_id)
     {
-        state = ThreadStates::IDLE;
+        clear_stats();
+        state = ThreadStates::SEARCH; // busy until the thread allocated its state
         thread = std::thread(&SearchThread::main_loop, this);
     }
 
@@ -117,6 +154,15 @@ class alignas(64) SearchThread
     {
         return tb_hits.load(std::memory_order_relaxed);
     }
+    // sampled by other threads while searching, so only approximate
+    int get_depth() const
+    {
+        return reported_depth.load(std::memory_order_relaxed);
+    }
+    int get_sel_depth() const
+    {
+        return sel_depth.load(std::memory_order_relaxed);
+    }
 
     void wait_for_finish()
     {
@@ -125,9 +171,21 @@ class alignas(64) SearchThread
     }
 
     void start_search();
+    void sync_epoch();
+    void leave_epochs();
+    uint64_t get_pool_nodes();
 
     void main_loop()
     {
+        // allocate (and first touch) the big tables on the thread using them, all threads doing it in parallel
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            histories = std::make_unique<Histories>();
+            NN = std::make_unique<Network>();
+            state &= ~ThreadStates::SEARCH;
+            cv.notify_all();
+        }
+
         while (!(state & ThreadStates::EXIT))
         {
             std::unique_lock<std::mutex> lock(mutex);
@@ -136,8 +194,11 @@ class alignas(64) SearchThread
             if (state & ThreadStates::EXIT)
                 return;
 
-            start_search();
-            state &= ~ThreadStates::SEARCH;
+            if (state & ThreadStates::CLEAR)
+                clear_history();
+            else
+                start_search();
+            state &= ~(ThreadStates::SEARCH | ThreadStates::CLEAR);
             cv.notify_all();
         }
     }
@@ -156,9 +217,16 @@ class alignas(64) SearchThread
         pv_table_len.fill(0);
         fill_multiarray<Move, MAX_DEPTH + 5, 2 * MAX_DEPTH + 5>(pv_table, NULLMOVE);
     }
+    void clear_stats()
+    {
+#ifdef SEARCH_STATS
+        for (int i = 0; i < SearchStats::STATS_COUNT; i++)
+            stats[i] = MeanValue(search_stats_names[i]);
+#endif
+    }
     void clear_history()
     {
-        histories.clear_history();
+        histories->clear_history();
         fill_multiarray<Move, 2, KP_MOVE_SIZE>(kp_move, NULLMOVE);
     }
 
@@ -166,13 +234,33 @@ class alignas(64) SearchThread
     {
         const Piece piece = board.piece_at(move.get_from());
         board.make_move(move, next_state);
-        NN.add_move_to_history(move, piece, board.captured());
+        NN->add_move_to_history(move, piece, board.captured());
     }
 
     void undo_move(Move move)
     {
         board.undo_move(move);
-        NN.revert_move();
+        NN->revert_move();
+    }
+
+    // in deterministic mode, TT writes are only visible to other threads after the current epoch;
+    // the entry is then copied to the caller's frame, as the buffer holding it may be flushed meanwhile
+    Entry *probe_tt(const Key key, bool &tt_hit, Entry &copy)
+    {
+        if (info.is_deterministic())
+        {
+            copy = tt_buffer.probe(*TT, key, tt_hit);
+            return &copy;
+        }
+        return TT->probe(key, tt_hit);
+    }
+    void save_tt(Entry *entry, const Key key, int score, int depth, int ply, int bound, Move move, int eval,
+                 bool was_pv)
+    {
+        if (info.is_deterministic())
+            tt_buffer.save(*TT, key, score, depth, ply, bound, move, eval, was_pv);
+        else
+            TT->save(entry, key, score, depth, ply, bound, move, eval, was_pv);
     }
 
   private:
@@ -189,10 +277,51 @@ class alignas(64) SearchThread
         std::copy(pv_table[ply + 1].data(), pv_table[ply + 1].data() + pv_table_len[ply + 1], pv_table[ply].data() + 1);
     }
 
+    bool skip_iteration(int depth) const
+    {
+        // the main thread searches every depth, the first iteration is needed to have a best move
+        if (main_thread() || depth == 1)
+            return false;
+        switch (info.get_skip_schedule())
+        {
+        case SkipSchedules::SKIP_BLOCKS: {
+            const int i = (thread_id - 1) % SKIP_TABLE_SIZE;
+            return ((depth + board.game_ply + skip_phase[i]) / skip_size[i]) % 2;
+        }
+        case SkipSchedules::SKIP_ALTERNATE:
+            return thread_id % 2 == 0 && depth % 2 == 1;
+        default:
+            return false;
+        }
+    }
+
+    void publish_root_moves(int depth)
+    {
+        std::lock_guard<std::mutex> lock(root_moves_mutex);
+        published_root_moves = root_moves;
+        published_depth = depth;
+    }
+
+  public:
+    void clear_published_root_moves()
+    {
+        std::lock_guard<std::mutex> lock(root_moves_mutex);
+        published_root_moves = RootMoves();
+        published_depth = 0;
+    }
+
+  private:
+
     void print_iteration_info(uint64_t t, int depth, uint64_t total_nodes, uint64_t total_tb_hits);
 
     template <bool checkTime> bool check_for_stop()
     {
+        if (info.is_deterministic() && ++epoch_nodes == DETERMINISTIC_EPOCH_NODES)
+        {
+            epoch_nodes = 0;
+            sync_epoch();
+        }
+
         if (!main_thread())
             return 0;
 
@@ -210,7 +339,10 @@ class alignas(64) SearchThread
         {
             if constexpr (checkTime)
             {
-                if (info.hard_limit_passed())
+                // in deterministic mode, the time is checked at the end of each epoch instead
+                // the nodes of the other threads are only summed when they stand for the time
+                if (!info.is_deterministic() &&
+                    info.hard_limit_passed(info.get_nodes_time() ? get_pool_nodes() : get_nodes()))
                     state |= ThreadStates::STOP;
             }
             time_check_count = 0;
@@ -225,6 +357,23 @@ class alignas(64) SearchThread
     }
 };
 
+// leaves the deterministic epoch barrier when the search of a thread ends, whichever way it ends,
+// otherwise the other threads would wait for it forever
+struct EpochExit
+{
+    SearchThread *thread;
+    ~EpochExit()
+    {
+        thread->leave_epochs();
+    }
+};
+
+struct EpochCompletion
+{
+    ThreadPool *thread_pool;
+    void operator()() noexcept;
+};
+
 class ThreadPool
 {
   public:
@@ -232,6 +381,21 @@ class ThreadPool
     Info info;
     Board board;
 
+    // deterministic mode: threads search in lockstep epochs, stopping only at the end of one
+    std::unique_ptr<std::barrier<EpochCompletion>> epoch_barrier;
+    std::atomic<bool> stop_requested{false};
+
+    // root moves kept after probing the tablebases at the root, empty if all moves are searched
+    std::vector<Move> tb_root_moves;
+    uint64_t root_tb_hits = 0;
+
+    // time from receiving go to sending bestmove, for the last search
+    std::atomic<std::time_t> last_search_time{-1};
+
+#ifndef GENERATE
+    Telemetry telemetry;
+#endif
+
     ThreadPool()
     {
         create_pool(0);
@@ -249,6 +413,7 @@ class ThreadPool
         threads.clear();
         for (std::size_t i = 0; i < thread_count; i++)
             threads.push_back(std::make_unique<SearchThread>(this, i));
+        wait_for_finish();
     }
 
     std::size_t get_num_threads()
@@ -264,13 +429,50 @@ class ThreadPool
 
     void stop()
     {
+        if (epoch_barrier)
+        {
+            stop_requested = true;
+            return;
+        }
         for (auto &thread : threads)
             thread->state |= ThreadStates::STOP;
     }
+
+    // stops the current search, if any, before the pool or the hash table are modified
+    void stop_and_wait()
+    {
+        stop();
+        wait_for_finish();
+#ifndef GENERATE
+        telemetry.stop();
+#endif
+    }
+
+    // called by the last thread arriving at the end of an epoch, while every other thread is waiting
+    void end_epoch()
+    {
+        // publish TT writes in thread order, so the resulting table doesn't depend on scheduling
+        for (auto &thread : threads)
+        {
+#ifdef GENERATE
+            thread->tt_buffer.flush(*thread->TT);
+#else
+            thread->tt_buffer.flush(*TT);
+#endif
+        }
+        if (stop_requested || info.hard_limit_passed(get_nodes()))
+        {
+            for (auto &thread : threads)
+                thread->state |= ThreadStates::STOP;
+        }
+    }
     void exit()
     {
         for (auto &thread : threads)
             thread->exit();
+#ifndef GENERATE
+        telemetry.stop();
+#endif
     }
     void wait_for_finish(bool main_as_well = true)
     {
@@ -285,10 +487,17 @@ class ThreadPool
         for (auto &thread : threads)
             thread->nodes = thread->tb_hits = 0;
     }
+    // each thread clears its own tables, in parallel
     void clear_history()
     {
         for (auto &thread : threads)
-            thread->clear_history();
+        {
+            std::lock_guard<std::mutex> lock(thread->mutex);
+            thread->state |= ThreadStates::SEARCH | ThreadStates::CLEAR;
+        }
+        for (auto &thread : threads)
+            thread->cv.notify_all();
+        wait_for_finish();
     }
     void clear_board()
     {
@@ -308,19 +517,165 @@ class ThreadPool
         return nodes;
     }
 
+    // statistics are gathered since the creation of the pool
+    void print_stats()
+    {
+#ifdef SEARCH_STATS
+        for (int i = 0; i < SearchStats::STATS_COUNT; i++)
+        {
+            MeanValue total(search_stats_names[i]);
+            for (auto &thread : threads)
+                total.merge(thread->stats[i]);
+            total.print_mean();
+        }
+#else
+        std::cout << "info string search stats are disabled, compile with -DSEARCH_STATS" << std::endl;
+#endif
+    }
+
     uint64_t get_tbhits()
     {
-        uint64_t tbhits = 0;
+        uint64_t tbhits = root_tb_hits;
         for (auto &thread : threads)
             tbhits += thread->get_tb_hits();
         return tbhits;
     }
 
+    // when MultiPV is split, root moves are partitioned in groups, each group of threads searching its own lines
+    int get_multipv_groups()
+    {
+        if (!info.is_multipv_split() || info.get_multipv() == 1)
+            return 1;
+        MoveList moves;
+        const int nr_moves = filter_root_moves(moves, board.gen_legal_moves<MOVEGEN_ALL>(moves));
+        return std::max(1, std::min<int>(threads.size(), nr_moves));
+    }
+
+    // rank the root moves with the DTZ tables (WDL if they are missing) and keep only the best ranked ones
+    void probe_root_TB()
+    {
+        tb_root_moves.clear();
+        root_tb_hits = 0;
+        const Bitboard pieces = board.get_bb_color(WHITE) | board.get_bb_color(BLACK);
+        // the tablebases don't handle castling rights
+        if (static_cast<uint32_t>(pieces.count()) > tb_probe_limit() || board.has_castling_rights())
+            return;
+
+        auto results = std::make_unique<TbRootMoves>();
+        const uint64_t white = board.get_bb_color(WHITE), black = board.get_bb_color(BLACK);
+        const uint64_t kings = board.get_bb_piece_type(PieceTypes::KING),
+                       queens = board.get_bb_piece_type(PieceTypes::QUEEN),
+                       rooks = board.get_bb_piece_type(PieceTypes::ROOK),
+                       bishops = board.get_bb_piece_type(PieceTypes::BISHOP),
+                       knights = board.get_bb_piece_type(PieceTypes::KNIGHT),
+                       pawns = board.get_bb_piece_type(PieceTypes::PAWN);
+        const unsigned ep = board.enpas() == NO_SQUARE ? 0 : static_cast<unsigned>(board.enpas());
+        if (!tb_probe_root_dtz(white, black, kings, queens, rooks, bishops, knights, pawns, board.half_moves(), 0, ep,
+                               board.turn, board.has_repeated(), true, results.get()) &&
+            !tb_probe_root_wdl(white, black, kings, queens, rooks, bishops, knights, pawns, board.half_moves(), 0, ep,
+                               board.turn, true, results.get()))
+            return;
+        if (!results->size)
+            return;
+
+        root_tb_hits = results->size;
+        int32_t best_rank = results->moves[0].tbRank;
+        for (unsigned i = 1; i < results->size; i++)
+            best_rank = std::max(best_rank, results->moves[i].tbRank);
+
+        MoveList moves;
+        const int nr_moves = board.gen_legal_moves<MOVEGEN_ALL>(moves);
+        for (int i = 0; i < nr_moves; i++)
+        {
+            const Move move = moves[i];
+            for (unsigned j = 0; j < results->size; j++)
+            {
+                const TbMove tb_move = results->moves[j].move;
+                // fathom promotions go from queen (1) to knight (4)
+                const unsigned promotes = move.is_promo() ? 4 - move.get_prom() : TB_PROMOTES_NONE;
+                if (TB_MOVE_FROM(tb_move) == move.get_from() && TB_MOVE_TO(tb_move) == move.get_to() &&
+                    TB_MOVE_PROMOTES(tb_move) == promotes && results->moves[j].tbRank == best_rank)
+                {
+                    tb_root_moves.push_back(move);
+                    break;
+                }
+            }
+        }
+    }
+
+    // remove the root moves losing the tablebase result, returns the new number of moves
+    int filter_root_moves(MoveList &moves, int nr_moves)
+    {
+        if (tb_root_moves.empty())
+            return nr_moves;
+        int kept = 0;
+        for (int i = 0; i < nr_moves; i++)
+        {
+            if (std::find(tb_root_moves.begin(), tb_root_moves.end(), moves[i]) != tb_root_moves.end())
+                moves[kept++] = moves[i];
+        }
+        return kept;
+    }
+
+    // merge the best lines of each group, reporting the smallest depth among them
+    RootMoves gather_root_moves(int &depth)
+    {
+        const int groups = info.get_multipv_groups();
+        RootMoves merged;
+        depth = MAX_DEPTH;
+        for (int group = 0; group < groups; group++)
+        {
+            SearchThread *best_thread = nullptr;
+            int best_depth = 0;
+            for (std::size_t i = group; i < threads.size(); i += groups)
+            {
+                std::lock_guard<std::mutex> lock(threads[i]->root_moves_mutex);
+                if (threads[i]->published_depth > best_depth)
+                {
+                    best_depth = threads[i]->published_depth;
+                    best_thread = threads[i].get();
+                }
+            }
+            if (!best_thread)
+                continue;
+
+            std::lock_guard<std::mutex> lock(best_thread->root_moves_mutex);
+            const RootMoves &lines = best_thread->published_root_moves;
+            depth = std::min(depth, best_thread->published_depth);
+            for (int i = 0; i < std::min(info.get_multipv(), lines.size()); i++)
+                merged.root_moves.push_back(lines[i]);
+        }
+        merged.sort();
+        return merged;
+    }
+
     void search(Info _info)
     {
         info = _info;
         stop();
         wait_for_finish();
+        probe_root_TB();
+        info.set_multipv_groups(get_multipv_groups());
+        // the threads share the root state, compute its lazy part before they start
+        board.checkers();
+        board.threats();
+        if (info.is_abdada())
+            abdada_table.clear();
+        epoch_barrier.reset();
+        if (info.is_deterministic())
+        {
+            // ABDADA marks depend on the scheduling of the threads
+            info.set_abdada(false);
+            stop_requested = false;
+            epoch_barrier = std::make_unique<std::barrier<EpochCompletion>>(threads.size(), EpochCompletion{this});
+        }
+        // no thread is running yet, so the main thread can't merge lines left over from the previous search
+        for (auto &thread : threads)
+            thread->clear_published_root_moves();
+#ifndef GENERATE
+        if (printStats) // not while benching
+            telemetry.start(*this);
+#endif
         for (auto &thread : threads)
         {
             thread->state &= ~ThreadStates::STOP;
@@ -341,16 +696,60 @@ class ThreadPool
         int bestDepth = threads.front()->completed_depth;
         best_score = threads.front()->root_moves[0].score;
         best_move = threads.front()->root_moves[0].pv[0];
-        for (std::size_t i = 1; i < threads.size(); i++)
+        if (info.get_multipv_groups() > 1)
         {
-            if (threads[i]->root_moves[0].score > best_score && threads[i]->completed_depth >= bestDepth)
+            int depth;
+            const RootMoves merged = gather_root_moves(depth);
+            if (!merged.empty())
+                best_move = merged[0].pv[0];
+        }
+        else if (info.is_best_thread_voting())
+        {
+            // each thread votes for its best move, weighted by how good the score is and how deep it searched
+            // threads without a completed iteration still have a -INF score and don't vote
+            int min_score = INF;
+            for (auto &thread : threads)
             {
-                best_score = threads[i]->root_moves[0].score;
-                best_move = threads[i]->root_moves[0].pv[0];
-                bestDepth = threads[i]->completed_depth;
+                if (thread->completed_depth)
+                    min_score = std::min<int>(min_score, thread->root_moves[0].score);
+            }
+
+            std::vector<std::pair<Move, int64_t>> votes;
+            for (auto &thread : threads)
+            {
+                if (!thread->completed_depth)
+                    continue;
+                const Move move = thread->root_moves[0].move();
+                const int64_t vote = int64_t(thread->root_moves[0].score - min_score + 14) * thread->completed_depth;
+                auto it = std::find_if(votes.begin(), votes.end(), [&](auto &entry) { return entry.first == move; });
+                if (it != votes.end())
+                    it->second += vote;
+                else
+                    votes.emplace_back(move, vote);
+            }
+            if (!votes.empty())
+                best_move = std::max_element(votes.begin(), votes.end(), [](auto &a, auto &b) {
+                                return a.second < b.second;
+                            })->first;
+        }
+        else
+        {
+            for (std::size_t i = 1; i < threads.size(); i++)
+            {
+                if (threads[i]->root_moves[0].score > best_score && threads[i]->completed_depth >= bestDepth)
+                {
+                    best_score = threads[i]->root_moves[0].score;
+                    best_move = threads[i]->root_moves[0].pv[0];
+                    bestDepth = threads[i]->completed_depth;
+                }
             }
         }
 
+        last_search_time = info.get_time_elapsed();
+#ifndef GENERATE
+        // the final report is written before bestmove, while the pool and the hash table can't change
+        telemetry.stop();
+#endif
         if (printStats)
         {
             std::cout << "bestmove " << best_move.to_string(threads[0]->info.is_chess960()) << std::endl;
@@ -358,4 +757,29 @@ class ThreadPool
     }
 };
 
+void EpochCompletion::operator()() noexcept
+{
+    thread_pool->end_epoch();
+}
+
+void SearchThread::sync_epoch()
+{
+    thread_pool->epoch_barrier->arrive_and_wait();
+}
+
+void SearchThread::leave_epochs()
+{
+    if (!info.is_deterministic())
+        return;
+    // the main thread finishing stops the other threads at the end of the current epoch
+    if (main_thread())
+        thread_pool->stop();
+    thread_pool->epoch_barrier->arrive_and_drop();
+}
+
+uint64_t SearchThread::get_pool_nodes()
+{
+    return thread_pool->get_nodes();
+}
+
 static ThreadPool thread_pool;
\ No newline at end of file
@@ -172,10 +172,20 @@ class HashTable
         __builtin_prefetch(bucket);
     }
 
+    uint64_t index(const Key hash) const
+    {
+        return mul_hi(hash, buckets);
+    }
+
     Entry *probe(const Key hash, bool &ttHit)
     {
-        const uint64_t ind = mul_hi(hash, buckets);
-        Entry *bucket = table[ind].entries.data();
+        return probe_bucket(table[index(hash)], hash, ttHit);
+    }
+
+    Entry *probe_bucket(Bucket &b, const Key hash, bool &ttHit)
+    {
+        PROFILE_SCOPE(TT_PROBE);
+        Entry *bucket = b.entries.data();
         const uint16_t hash16 = static_cast<uint16_t>(hash);
 
         for (int i = 0; i < BUCKET_COUNT; i++)
@@ -201,6 +211,7 @@ class HashTable
 
     void save(Entry *entry, Key hash, int score, int depth, int ply, int bound, Move move, int eval, bool was_pv)
     {
+        PROFILE_SCOPE(TT_SAVE);
         if (score != VALUE_NONE)
         {
             if (score >= TB_WIN_SCORE)
@@ -245,6 +256,81 @@ class HashTable
     }
 };
 
+// private copies of the buckets touched by a thread during a deterministic search epoch,
+// the modified ones being written back to the shared table at the end of the epoch
+// a node touches at most one bucket, so an epoch of max_buckets nodes fits in a fixed open addressing table
+template <int max_buckets> class BucketBuffer
+{
+  private:
+    static constexpr int SLOTS = 4 * max_buckets; // at most about a quarter full, keeping the probe chains short
+    static_assert((SLOTS & (SLOTS - 1)) == 0);
+    static constexpr uint64_t EMPTY = ~0ull;
+
+    struct BufferedBucket
+    {
+        uint64_t ind = EMPTY;
+        Bucket bucket;
+        bool dirty = false;
+    };
+    // allocated on first use, since only deterministic searches need them
+    std::unique_ptr<BufferedBucket[]> buckets;
+    std::unique_ptr<int[]> used;
+    int nr_used = 0;
+
+    BufferedBucket &get(HashTable &tt, const Key hash)
+    {
+        if (!buckets)
+        {
+            buckets = std::make_unique<BufferedBucket[]>(SLOTS);
+            used = std::make_unique<int[]>(SLOTS);
+        }
+        // the table index comes from the high bits of the key, its low bits are as good as random
+        const uint64_t ind = tt.index(hash);
+        int slot = ind & (SLOTS - 1);
+        while (buckets[slot].ind != ind)
+        {
+            if (buckets[slot].ind == EMPTY)
+            {
+                assert(nr_used < SLOTS - 1);
+                buckets[slot].ind = ind;
+                buckets[slot].bucket = tt.table[ind];
+                used[nr_used++] = slot;
+                break;
+            }
+            slot = (slot + 1) & (SLOTS - 1);
+        }
+        return buckets[slot];
+    }
+
+  public:
+    // entries are returned by value and saved by key, since the buffer is cleared at the end of every epoch
+    Entry probe(HashTable &tt, const Key hash, bool &ttHit)
+    {
+        return *tt.probe_bucket(get(tt, hash).bucket, hash, ttHit);
+    }
+
+    void save(HashTable &tt, Key hash, int score, int depth, int ply, int bound, Move move, int eval, bool was_pv)
+    {
+        BufferedBucket &buffered = get(tt, hash);
+        buffered.dirty = true;
+        bool ttHit;
+        tt.save(tt.probe_bucket(buffered.bucket, hash, ttHit), hash, score, depth, ply, bound, move, eval, was_pv);
+    }
+
+    void flush(HashTable &tt)
+    {
+        for (int i = 0; i < nr_used; i++)
+        {
+            BufferedBucket &buffered = buckets[used[i]];
+            if (buffered.dirty)
+                tt.table[buffered.ind] = buffered.bucket;
+            buffered.ind = EMPTY;
+            buffered.dirty = false;
+        }
+        nr_used = 0;
+    }
+};
+
 #ifndef GENERATE
 std::unique_ptr<HashTable> TT; // shared hash table
 #endif
\ No newline at end of file
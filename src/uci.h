@@ -17,8 +17,10 @@
 #pragma once
 #include "3rdparty/Fathom/src/tbprobe.h"
 #include "movegen.h"
+#include "perf-counters.h"
 #include "perft.h"
 #include "search.h"
+#include <charconv>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -29,6 +31,19 @@
 
 const std::string VERSION = VERSION_NAME;
 
+// reads one bench argument, a depth or perf, arguments that are neither are reported and ignored
+inline void parse_bench_arg(const std::string &arg, int &depth, bool &perf)
+{
+    int value = 0;
+    const auto [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+    if (arg == "perf")
+        perf = true;
+    else if (ec == std::errc() && end == arg.data() + arg.size())
+        depth = value;
+    else
+        std::cout << "info string ignoring bench argument " << arg << std::endl;
+}
+
 class Option
 {
   private:
@@ -78,14 +93,28 @@ class UCI
     std::unordered_map<std::string, Option> options;
     Info info;
 
+    // move overhead, either fixed or estimated from the time the GUI charges us on top of our search
+    int move_overhead;
+    bool adaptive_overhead;
+    std::time_t last_clock, lag_estimate;
+    int last_inc, last_movestogo;
+
+    TBWarmup tb_warmup;
+    std::string syzygy_path;
+    uint64_t syzygy_warmup_mb;
+    // the tablebase cache is only allocated while tablebases are loaded
+    uint64_t syzygy_cache_mb;
+
   public:
-    UCI() : tt_size_mb(8)
+    UCI() : tt_size_mb(8), move_overhead(100), adaptive_overhead(false), last_clock(-1), lag_estimate(-1),
+          syzygy_warmup_mb(0), syzygy_cache_mb(TBCache::DEFAULT_SIZE_MB)
     {
         options = {{"Hash",
                     {"Hash", "spin", "8", "2", "262144",
                      [&](std::istringstream &iss) {
                          std::string value;
                          iss >> value >> tt_size_mb;
+                         thread_pool.stop_and_wait();
                          TT->init(tt_size_mb * MB, thread_pool.get_num_threads());
                      }}},
                    {"Threads",
@@ -94,15 +123,47 @@ class UCI
                          std::string value;
                          int thread_count;
                          iss >> value >> thread_count;
+                         std::time_t start = get_current_time();
                          thread_pool.create_pool(thread_count);
+                         std::cout << "info string created " << thread_count << " threads in "
+                                   << get_current_time() - start << " ms" << std::endl;
                          ucinewgame();
                      }}},
                    {"SyzygyPath",
                     {"SyzygyPath", "string", "<empty>", "", "",
                      [&](std::istringstream &iss) {
-                         std::string value, path;
-                         iss >> value >> path;
-                         tb_init(path.c_str());
+                         std::string value;
+                         iss >> value >> syzygy_path;
+                         thread_pool.stop_and_wait();
+                         tb_init(syzygy_path.c_str());
+                         tb_cache.init(TB_LARGEST ? syzygy_cache_mb * MB : 0);
+                     }}},
+                   {"SyzygyProbeLimit",
+                    {"SyzygyProbeLimit", "spin", "7", "0", "7",
+                     [&](std::istringstream &iss) {
+                         std::string value;
+                         iss >> value >> syzygy_probe_limit;
+                     }}},
+                   {"SyzygyProbeDepth",
+                    {"SyzygyProbeDepth", "spin", "2", "1", "100",
+                     [&](std::istringstream &iss) {
+                         std::string value;
+                         iss >> value >> syzygy_probe_depth;
+                     }}},
+                   // MB of WDL tables read ahead after each position command, 0 to disable
+                   {"SyzygyWarmup",
+                    {"SyzygyWarmup", "spin", "0", "0", "4096",
+                     [&](std::istringstream &iss) {
+                         std::string value;
+                         iss >> value >> syzygy_warmup_mb;
+                     }}},
+                   {"SyzygyCache",
+                    {"SyzygyCache", "spin", std::to_string(TBCache::DEFAULT_SIZE_MB), "0", "4096",
+                     [&](std::istringstream &iss) {
+                         std::string value;
+                         iss >> value >> syzygy_cache_mb;
+                         thread_pool.stop_and_wait();
+                         tb_cache.init(TB_LARGEST ? syzygy_cache_mb * MB : 0);
                      }}},
                    {"MultiPV",
                     {"MultiPV", "spin", "1", "1", "255",
@@ -112,6 +173,78 @@ class UCI
                          iss >> value >> multipv;
                          info.set_multipv(multipv);
                      }}},
+                   {"MultiPVSplit",
+                    {"MultiPVSplit", "check", "false", "", "",
+                     [&](std::istringstream &iss) {
+                         std::string value;
+                         iss >> value >> value;
+                         info.set_multipv_split(value == "true");
+                     }}},
+                   {"ABDADA",
+                    {"ABDADA", "check", "false", "", "",
+                     [&](std::istringstream &iss) {
+                         std::string value;
+                         iss >> value >> value;
+                         info.set_abdada(value == "true");
+                     }}},
+                   {"HelperSkipSchedule",
+                    {"HelperSkipSchedule", "spin", "0", "0", "2",
+                     [&](std::istringstream &iss) {
+                         std::string value;
+                         int schedule;
+                         iss >> value >> schedule;
+                         info.set_skip_schedule(schedule);
+                     }}},
+                   {"BestThreadVoting",
+                    {"BestThreadVoting", "check", "false", "", "",
+                     [&](std::istringstream &iss) {
+                         std::string value;
+                         iss >> value >> value;
+                         info.set_best_thread_voting(value == "true");
+                     }}},
+                   {"Deterministic",
+                    {"Deterministic", "check", "false", "", "",
+                     [&](std::istringstream &iss) {
+                         std::string value;
+                         iss >> value >> value;
+                         info.set_deterministic(value == "true");
+                     }}},
+                   {"TelemetryFile",
+                    {"TelemetryFile", "string", "<empty>", "", "",
+                     [&](std::istringstream &iss) {
+                         std::string value, path;
+                         iss >> value >> path;
+                         thread_pool.telemetry.set_path(path);
+                     }}},
+                   {"TelemetryInterval",
+                    {"TelemetryInterval", "spin", "1000", "100", "60000",
+                     [&](std::istringstream &iss) {
+                         std::string value;
+                         int interval;
+                         iss >> value >> interval;
+                         thread_pool.telemetry.set_interval(interval);
+                     }}},
+                   {"MoveOverhead",
+                    {"MoveOverhead", "spin", "100", "0", "5000",
+                     [&](std::istringstream &iss) {
+                         std::string value;
+                         iss >> value >> move_overhead;
+                     }}},
+                   {"AdaptiveOverhead",
+                    {"AdaptiveOverhead", "check", "false", "", "",
+                     [&](std::istringstream &iss) {
+                         std::string value;
+                         iss >> value >> value;
+                         adaptive_overhead = value == "true";
+                     }}},
+                   {"NodesTime",
+                    {"NodesTime", "spin", "0", "0", "100000",
+                     [&](std::istringstream &iss) {
+                         std::string value;
+                         int nodes_time;
+                         iss >> value >> nodes_time;
+                         info.set_nodes_time(nodes_time);
+                     }}},
                    {"UCI_Chess960",
                     {"UCI_Chess960", "check", "false", "", "",
                      [&](std::istringstream &iss) {
@@ -142,18 +275,23 @@ class UCI
 
   public:
     void uci_loop();
-    void bench(int depth = -1);
+    void bench(int depth = -1, bool perf = false);
+    void bench_smp(std::size_t threads, int depth = -1);
 
   private:
+    std::pair<uint64_t, std::time_t> run_bench(int depth, std::size_t threads, bool abdada,
+                                               PerfCounters *perf_counters = nullptr);
     void uci();
     void ucinewgame();
     void is_ready();
     void set_option(std::istringstream &iss);
     void go(std::istringstream &iss, Info &info);
+    int get_move_overhead(std::time_t time, int inc, int movestogo);
     void stop();
     void quit();
     void eval();
-    void go_perft(int depth);
+    void go_perft(int depth, int threads = 1, uint64_t hash_mb = 0);
+    void perft_suite(const std::string &path, int max_depth);
     void set_param_int(std::istringstream &iss, int &value);
     void set_param_double(std::istringstream &iss, double &value);
 };
@@ -211,6 +349,9 @@ void UCI::uci_loop()
                     }
                 }
             }
+            // read the tables ahead while the GUI sends go and we think
+            if (syzygy_warmup_mb && !syzygy_path.empty())
+                tb_warmup.start(syzygy_path, thread_pool.get_board(), syzygy_warmup_mb * MB);
         }
         else if (cmd == "ucinewgame")
         {
@@ -252,13 +393,43 @@ void UCI::uci_loop()
         }
         else if (cmd == "perft")
         {
-            int depth;
+            int depth, threads;
+            uint64_t hash_mb;
             iss >> depth;
-            go_perft(depth);
+            if (!(iss >> threads))
+                threads = 1;
+            if (!(iss >> hash_mb))
+                hash_mb = 0;
+            go_perft(depth, std::max(1, threads), hash_mb);
+        }
+        else if (cmd == "perftsuite")
+        {
+            std::string path;
+            int max_depth;
+            iss >> path;
+            if (!(iss >> max_depth))
+                max_depth = MAX_DEPTH;
+            perft_suite(path, max_depth);
         }
         else if (cmd == "bench")
         {
-            bench();
+            int depth = -1;
+            bool perf = false;
+            std::string arg;
+            while (iss >> arg)
+                parse_bench_arg(arg, depth, perf);
+            bench(depth, perf);
+        }
+        else if (cmd == "stats")
+        {
+            thread_pool.print_stats();
+        }
+        else if (cmd == "benchsmp")
+        {
+            std::size_t threads = 4;
+            int depth = -1;
+            iss >> threads >> depth;
+            bench_smp(threads, depth);
         }
         else if (cmd == "evalbench")
         {
@@ -321,14 +492,37 @@ void UCI::set_option(std::istringstream &iss)
 
 void UCI::ucinewgame()
 {
+    thread_pool.stop_and_wait();
     thread_pool.clear_history();
     TT->init(tt_size_mb * MB, thread_pool.get_num_threads());
+    last_clock = lag_estimate = -1;
+}
+
+// the clock lost since the last go, minus the time we spent searching, is the lag of the GUI and the connection
+int UCI::get_move_overhead(std::time_t time, int inc, int movestogo)
+{
+    const std::time_t search_time = thread_pool.last_search_time;
+    // a new time control starts when movestogo runs out, so the clocks can't be compared
+    if (last_clock != -1 && search_time != -1 && last_movestogo != 1)
+    {
+        const std::time_t lag = std::max<std::time_t>(0, last_clock + last_inc - time - search_time);
+        // react quickly to spikes, forget them slowly
+        lag_estimate = lag_estimate == -1 ? lag : std::max(lag, (3 * lag_estimate + lag) / 4);
+    }
+    last_clock = time;
+    last_inc = inc;
+    last_movestogo = movestogo;
+
+    // with nodes time, the wall clock must not influence the search
+    if (!adaptive_overhead || lag_estimate == -1 || info.get_nodes_time())
+        return move_overhead;
+    return std::min<int>(5000, std::max<int>(10, lag_estimate * 3 / 2 + 10));
 }
 
 void UCI::go(std::istringstream &iss, Info &info)
 {
     int depth = MAX_DEPTH, movetime = -1;
-    int time = -1, inc = 0;
+    int time = -1, inc = 0, movestogo = 0;
     int64_t nodes = -1, min_nodes = -1, max_nodes = -1;
     bool turn = thread_pool.get_board().turn;
     info.init();
@@ -345,6 +539,8 @@ void UCI::go(std::istringstream &iss, Info &info)
             iss >> time;
         else if (param == "btime" && turn == BLACK)
             iss >> time;
+        else if (param == "movestogo")
+            iss >> movestogo;
         else if (param == "movetime")
             iss >> movetime;
         else if (param == "depth")
@@ -363,15 +559,17 @@ void UCI::go(std::istringstream &iss, Info &info)
     }
     else if (time != -1)
     {
-        const int MOVE_OVERHEAD = 100; // idk
-        time -= MOVE_OVERHEAD;
-        info.set_time(time, inc);
+        time -= get_move_overhead(time, inc, movestogo);
+        info.set_time(time, inc, movestogo);
     }
+    if (time == -1 || movetime != -1)
+        last_clock = -1; // the next clock can't be compared to a search without one
 
     info.set_min_nodes(min_nodes);
     info.set_max_nodes(max_nodes);
     info.set_nodes(nodes);
     info.set_depth(depth);
+    thread_pool.stop_and_wait();
     TT->age();
     thread_pool.clear_board();
     thread_pool.clear_info();
@@ -385,6 +583,7 @@ void UCI::stop()
 
 void UCI::quit()
 {
+    tb_warmup.stop();
     thread_pool.exit();
     exit(0);
 }
@@ -400,21 +599,77 @@ void UCI::is_ready()
     thread_pool.is_ready();
 }
 
-void UCI::go_perft(int depth)
+void UCI::go_perft(int depth, int threads, uint64_t hash_mb)
 {
+    if (depth < 1)
+    {
+        std::cout << "info string perft depth must be at least 1" << std::endl;
+        return;
+    }
+    PerftTable table(hash_mb * MB);
     std::time_t t1 = get_current_time();
-    uint64_t nodes;
-    if (info.is_chess960())
-        nodes = perft<true, true>(thread_pool.get_board(), depth);
-    else
-        nodes = perft<true, false>(thread_pool.get_board(), depth);
+    const auto divide = info.is_chess960() ? perft_divide<true>(thread_pool.get_board(), depth, threads, &table)
+                                           : perft_divide<false>(thread_pool.get_board(), depth, threads, &table);
     std::time_t t2 = get_current_time();
-    long double t = (t2 - t1) / 1000.0;
+
+    uint64_t nodes = 0;
+    for (auto &[move, move_nodes] : divide)
+    {
+        std::cout << move.to_string(info.is_chess960()) << ": " << move_nodes << "\n";
+        nodes += move_nodes;
+    }
+    long double t = std::max<std::time_t>(1, t2 - t1) / 1000.0;
     uint64_t nps = nodes / t;
 
     std::cout << "nodes: " << nodes << std::endl;
     std::cout << "time : " << t << std::endl;
     std::cout << "nps  : " << nps << std::endl;
+    std::cout << "Mnps : " << nps / 1e6 << std::endl;
+}
+
+// checks every position of an EPD file against its expected perft counts, on as many threads as the search uses
+void UCI::perft_suite(const std::string &path, int max_depth)
+{
+    std::vector<PerftSuiteEntry> suite = read_perft_suite(path, max_depth);
+    if (suite.empty())
+    {
+        std::cout << "info string no positions read from " << path << std::endl;
+        return;
+    }
+
+    const int threads = std::max<int>(1, thread_pool.get_num_threads());
+    std::time_t t1 = get_current_time();
+    if (info.is_chess960())
+        run_perft_suite<true>(suite, threads);
+    else
+        run_perft_suite<false>(suite, threads);
+    std::time_t t2 = get_current_time();
+
+    uint64_t nodes = 0;
+    int checks = 0, mismatches = 0;
+    for (auto &entry : suite)
+    {
+        for (std::size_t i = 0; i < entry.expected.size(); i++)
+        {
+            checks++;
+            if (entry.found[i] != entry.expected[i].second)
+            {
+                mismatches++;
+                std::cout << "mismatch: " << entry.fen << "depth " << entry.expected[i].first << " expected "
+                          << entry.expected[i].second << " found " << entry.found[i] << std::endl;
+            }
+        }
+        nodes += entry.nodes;
+    }
+    long double t = std::max<std::time_t>(1, t2 - t1) / 1000.0;
+    uint64_t nps = nodes / t;
+
+    std::cout << "positions : " << suite.size() << std::endl;
+    std::cout << "checks    : " << checks << std::endl;
+    std::cout << "mismatches: " << mismatches << std::endl;
+    std::cout << "nodes     : " << nodes << std::endl;
+    std::cout << "time      : " << t << std::endl;
+    std::cout << "Mnps      : " << nps / 1e6 << std::endl;
 }
 
 /// positions used for benching
@@ -472,21 +727,33 @@ std::string benchPos[] = {
     "2r2b2/5p2/5k2/p1r1pP2/P2pB3/1P3P2/K1P3R1/7R w - - 23 93",
 };
 
-void UCI::bench(int depth)
+std::pair<uint64_t, std::time_t> UCI::run_bench(int depth, std::size_t threads, bool abdada,
+                                                PerfCounters *perf_counters)
 {
+    thread_pool.stop_and_wait();
     TT = std::make_unique<HashTable>();
 
+    // open the counters before creating the threads, which inherit them
+    if (perf_counters && !perf_counters->open())
+        std::cout << "info string perf counters unavailable, check /proc/sys/kernel/perf_event_paranoid" << std::endl;
+
     info = Info();
+    info.set_abdada(abdada);
     tt_size_mb = 16;
-    thread_pool.create_pool(1);
+    thread_pool.create_pool(threads);
     thread_pool.wait_for_finish();
     ucinewgame();
 
     printStats = false;
 
+#ifdef PROFILER
+    profiler::reset();
+#endif
     std::time_t start = get_current_time();
     info.init();
     info.set_depth(depth == -1 ? 14 : depth);
+    if (perf_counters)
+        perf_counters->start();
 
     uint64_t totalNodes = 0;
     for (auto &fen : benchPos)
@@ -500,14 +767,58 @@ void UCI::bench(int depth)
         ucinewgame();
     }
 
+    if (perf_counters)
+        perf_counters->stop();
     std::time_t end = get_current_time();
-    long double t = 1.0 * (end - start) / 1000.0;
 
     printStats = true;
 
+    return {totalNodes, end - start};
+}
+
+void UCI::bench(int depth, bool perf)
+{
+    PerfCounters perf_counters;
+    const auto [totalNodes, time] = run_bench(depth, 1, false, perf ? &perf_counters : nullptr);
+    long double t = 1.0 * time / 1000.0;
+
+#ifdef SEARCH_STATS
+    thread_pool.print_stats();
+#endif
+#ifdef PROFILER
+    profiler::print(totalNodes);
+#endif
+    if (perf)
+        perf_counters.print(totalNodes);
     std::cout << totalNodes << " nodes " << int(totalNodes / t) << " nps" << std::endl;
 }
 
+/// compare Lazy SMP and ABDADA on the bench positions, time to depth being the relevant metric
+void UCI::bench_smp(std::size_t threads, int depth)
+{
+    // the benchmark is run in the middle of a session, restore the user's settings afterwards
+    const std::size_t user_threads = thread_pool.get_num_threads(), user_tt_size_mb = tt_size_mb;
+    const Info user_info = info;
+
+    std::time_t times[2];
+    for (int abdada = 0; abdada < 2; abdada++)
+    {
+        const auto [totalNodes, time] = run_bench(depth, threads, abdada);
+        long double t = 1.0 * std::max<std::time_t>(time, 1) / 1000.0;
+        times[abdada] = std::max<std::time_t>(time, 1);
+
+        std::cout << (abdada ? "ABDADA   : " : "Lazy SMP : ") << totalNodes << " nodes " << int(totalNodes / t)
+                  << " nps " << time << " ms" << std::endl;
+    }
+    std::cout << "ABDADA speedup over Lazy SMP with " << threads << " threads: " << std::fixed
+              << std::setprecision(3) << 1.0 * times[0] / times[1] << std::endl;
+
+    info = user_info;
+    tt_size_mb = user_tt_size_mb;
+    thread_pool.create_pool(user_threads);
+    ucinewgame();
+}
+
 void UCI::set_param_int(std::istringstream &iss, int &value)
 {
     std::string valuestr;